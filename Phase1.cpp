@@ -20,8 +20,8 @@ vector<string> errorLog;
 
 public:
 Student() : userId(0), studentId(""), firstName(""), lastName(""), email(""), accountBalance(0.0), isActive(true) {}
-Student(int uid, const string& sid, const string& first, const string& last, const string& em, float bal)
-: userId(uid), studentId(sid), firstName(first), lastName(last), email(em), accountBalance(bal), isActive(true) {}
+Student(int uid, string sid, string first, string last, string em, float bal)
+: userId(uid), studentId(move(sid)), firstName(move(first)), lastName(move(last)), email(move(em)), accountBalance(bal), isActive(true) {}
 void print() const {
     cout << "Student Info:\n";
     cout << "User ID: " << userId << "\n";
@@ -69,19 +69,19 @@ void printErrorLog() const {
     }
 }
 int getUserId() const { return userId; }
-string getStudentId() const { return studentId; }
-string getFirstName() const { return firstName; }
-string getLastName() const { return lastName; }
-string getEmail() const { return email; }
+const string& getStudentId() const { return studentId; }
+const string& getFirstName() const { return firstName; }
+const string& getLastName() const { return lastName; }
+const string& getEmail() const { return email; }
 float getAccountBallance() const { return accountBalance; }
 bool getIsActive() const { return isActive; }
-vector<Reservation*> getReservations() const { return reservations; }
-vector<string> getErrorLog() const { return errorLog; }
+const vector<Reservation*>& getReservations() const { return reservations; }
+const vector<string>& getErrorLog() const { return errorLog; }
 void setUserId(int uid) { userId = uid; }
-void setStudentId(const string& sid) { studentId = sid; }
-void setFirstName(const string& fn) { firstName = fn; }
-void setLastName(const string& ln) { lastName = ln; }
-void setEmail(const string& em) { email = em; }
+void setStudentId(string sid) { studentId = move(sid); }
+void setFirstName(string fn) { firstName = move(fn); }
+void setLastName(string ln) { lastName = move(ln); }
+void setEmail(string em) { email = move(em); }
 void setAccountBallance(float bal) { accountBalance = bal; }
 void setIsActive(bool active) { isActive = active; }
 };
@@ -109,14 +109,14 @@ class Meal {
         cout << "\n";
     }
     void updatePrice(float newPrice) { price = newPrice; }
-    void addSideItem(const string& item) { sideItems.push_back(item); }
+    void addSideItem(string item) { sideItems.push_back(move(item)); }
     int getMealId() const { return mealId; }
-    string getName() const { return name; }
+    const string& getName() const { return name; }
     float getPrice() const { return price; }
     MealType getMealType() const { return mealType; }
-    vector<string> getSideItems() const { return sideItems; }
+    const vector<string>& getSideItems() const { return sideItems; }
     void setMealId(int id) { mealId = id; }
-    void setName(const string& n) { name = n; }
+    void setName(string n) { name = move(n); }
     void setPrice(float p) { price = p; }
     void setMealType(MealType type) { mealType = type; }
     };
@@ -135,12 +135,12 @@ class Meal {
             cout << "Capacity: " << capacity << "\n";
         }
         int getHallId() const { return hallId; }
-        string getName() const { return name; }
-        string getAddress() const { return address; }
+        const string& getName() const { return name; }
+        const string& getAddress() const { return address; }
         int getCapacity() const { return capacity; }
         void setHallId(int id) { hallId = id; }
-        void setName(const string& n) { name = n; }
-        void setAddress(const string& addr) { address = addr; }
+        void setName(string n) { name = move(n); }
+        void setAddress(string addr) { address = move(addr); }
         void setCapacity(int cap) { capacity = cap; }
         };
         class Reservation {
@@ -154,8 +154,8 @@ class Meal {
             
             public:
             Reservation() : reservationId(0), student(nullptr), meal(nullptr), diningHall(nullptr), status(ReservationStatus::SUCCESS), createdAt("unknown"), date("unknown") {}
-            Reservation(int id, Student* s, Meal* m, DiningHall* d, const string& time, const string& resDate)
-            : reservationId(id), student(s), meal(m), diningHall(d), status(ReservationStatus::SUCCESS), createdAt(time), date(resDate) {}
+            Reservation(int id, Student* s, Meal* m, DiningHall* d, string time, string resDate)
+            : reservationId(id), student(s), meal(m), diningHall(d), status(ReservationStatus::SUCCESS), createdAt(move(time)), date(move(resDate)) {}
             void print() const {
                 cout << "Reservation ID: " << reservationId << "\n";
                 cout << "Status: ";
@@ -179,16 +179,16 @@ class Meal {
             Meal* getMeal() const { return meal; }
             DiningHall* getDiningHall() const { return diningHall; }
             ReservationStatus getStatus() const { return status; }
-            string getCreatedAt() const { return createdAt; }
-            string getDate() const { return date; }
+            const string& getCreatedAt() const { return createdAt; }
+            const string& getDate() const { return date; }
             MealType getMealType() const { return meal->getMealType(); }
             void setReservationId(int id) { reservationId = id; }
             void setStudent(Student* s) { student = s; }
             void setMeal(Meal* m) { meal = m; }
             void setDiningHall(DiningHall* d) { diningHall = d; }
             void setStatus(ReservationStatus st) { status = st; }
-            void setCreatedAt(const string& time) { createdAt = time; }
-            void setDate(const string& d) { date = d; }
+            void setCreatedAt(string time) { createdAt = move(time); }
+            void setDate(string d) { date = move(d); }
             };
 
             int main (){
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <ctime>
 
 using namespace std;
@@ -18,8 +19,8 @@ string hashedPassword;
 
 public:
 User() : userId(0), name(""), lastName(""), hashedPassword("") {}
-User(int uid, const string& n, const string& l, const string& pass)
-: userId(uid), name(n), lastName(l), hashedPassword(pass) {}
+User(int uid, string n, string l, string pass)
+: userId(uid), name(move(n)), lastName(move(l)), hashedPassword(move(pass)) {}
 
 virtual void print() const {  
     cout << "User Info:" << endl;  
@@ -27,17 +28,17 @@ virtual void print() const {
     cout << "Name: " << name << " " << lastName << endl;  
 }  
 
-virtual string getType() const = 0;  
+virtual string_view getType() const = 0;  
 
 int getUserId() const { return userId; }  
-string getName() const { return name; }  
-string getLastName() const { return lastName; }  
-string getHashedPassword() const { return hashedPassword; }  
+const string& getName() const { return name; }  
+const string& getLastName() const { return lastName; }  
+const string& getHashedPassword() const { return hashedPassword; }  
 
 void setUserId(int id) { userId = id; }  
-void setName(const string& n) { name = n; }  
-void setLastName(const string& l) { lastName = l; }  
-void setHashedPassword(const string& pass) { hashedPassword = pass; }
+void setName(string n) { name = move(n); }  
+void setLastName(string l) { lastName = move(l); }  
+void setHashedPassword(string pass) { hashedPassword = move(pass); }
 
 };
 
@@ -58,9 +59,9 @@ public:
 Student()
 : User(), studentId(""), email(""), phone(""), accountBalance(0.0), isActive(true) {}
 
-Student(int uid, const string& sid, const string& first, const string& last,  
-        const string& em, const string& ph, float bal, const string& pass)  
-    : User(uid, first, last, pass), studentId(sid), email(em), phone(ph),  
+Student(int uid, string sid, string first, string last,  
+        string em, string ph, float bal, string pass)  
+    : User(uid, move(first), move(last), move(pass)), studentId(move(sid)), email(move(em)), phone(move(ph)),  
       accountBalance(bal), isActive(true) {}  
 
 void print() const override {  
@@ -74,21 +75,21 @@ void print() const override {
     cout << "Active: " << (isActive ? "Yes" : "No") << endl;  
 }
 
-string getType() const override { return "Student"; }  
+string_view getType() const override { return "Student"; }  
 
 void activate() { isActive = true; }  
 void deactivate() { isActive = false; }  
 bool getIsActive() const { return isActive; }  
 
-vector<Reservation*> getReserves() const { return reservations; }
+const vector<Reservation*>& getReserves() const { return reservations; }
 
 };
 
 class Admin : public User {
 public:
 Admin() : User() {}
-Admin(int uid, const string& n, const string& l, const string& pass)
-: User(uid, n, l, pass) {}
+Admin(int uid, string n, string l, string pass)
+: User(uid, move(n), move(l), move(pass)) {}
 
 void print() const override {  
     cout << "Admin Info:" << endl;  
@@ -96,7 +97,7 @@ void print() const override {
     cout << "Name: " << name << " " << lastName << endl;  
 }  
 
-string getType() const override { return "Admin"; }
+string_view getType() const override { return "Admin"; }
 
 };
 
@@ -144,18 +145,18 @@ class Meal {
 void deactivate() { isActive = false; }  
 bool getIsActive() const { return isActive; }  
 
-void addSideItem(const string& item) { sideItems.push_back(item); }  
+void addSideItem(string item) { sideItems.push_back(move(item)); }  
 void updatePrice(float newPrice) { price = newPrice; }  
 
 int getMealId() const { return mealId; }  
-string getName() const { return name; }  
+const string& getName() const { return name; }  
 float getPrice() const { return price; }  
 MealType getMealType() const { return mealType; }  
 ReserveDay getReserveDay() const { return reserveDay; }  
-vector<string> getSideItems() const { return sideItems; }  
+const vector<string>& getSideItems() const { return sideItems; }  
 
 void setMealId(int id) { mealId = id; }  
-void setName(const string& n) { name = n; }  
+void setName(string n) { name = move(n); }  
 void setPrice(float p) { price = p; }  
 void setMealType(MealType type) { mealType = type; }  
 void setReserveDay(ReserveDay day) { reserveDay = day; }
@@ -179,13 +180,13 @@ class DiningHall {
     }  
     
     int getHallId() const { return hallId; }  
-    string getName() const { return name; }  
-    string getAddress() const { return address; }  
+    const string& getName() const { return name; }  
+    const string& getAddress() const { return address; }  
     int getCapacity() const { return capacity; }  
     
     void setHallId(int id) { hallId = id; }  
-    void setName(const string& n) { name = n; }  
-    void setAddress(const string& addr) { address = addr; }  
+    void setName(string n) { name = move(n); }  
+    void setAddress(string addr) { address = move(addr); }  
     void setCapacity(int cap) { capacity = cap; }
     
     };
@@ -1,16 +1,645 @@
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <ctime>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+#include <cstring>
+#include <cstdlib>
+#include <charconv>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <shared_mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <csignal>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
 enum class MealType { BREAKFAST, LUNCH, DINNER };
-enum class RStatus { SUCCESS, CANCELLED, FAILED, NOT_PAID };
+enum class RStatus { SUCCESS, CANCELLED, FAILED, NOT_PAID, CHECKED_IN };
 enum class ReserveDay { SATURDAY, SUNDAY, MONDAY, TUESDAY, WEDNESDAY };
 enum class TransactionType { TRANSFER, PAYMENT };
 enum class TransactionStatus { PENDING, COMPLETED, FAILED };
 enum class SessionStatus { AUTHENTICATED, ANONYMOUS };
+enum class OutputMode { TEXT, JSON };
+enum class EventCode : uint16_t { ALREADY_RESERVED, HALL_FULL, INSUFFICIENT_BALANCE, INACTIVE_MEAL, NOT_DURABLE };
+enum class TicketStatus { OK, NOT_FOUND, NOT_OWNER, WRONG_HALL, WRONG_DAY, NOT_ACTIVE, NOT_DURABLE };
+enum class CheckoutStatus { CONFIRMED, EMPTY_CART, INACTIVE_MEAL, ALREADY_RESERVED, HALL_FULL, INSUFFICIENT_BALANCE, NOT_DURABLE };
+enum class BulkFormat { CSV, BINARY };
+enum class ImportStatus { OK, OPEN_FAILED, BAD_HEADER, BAD_ROW, NOT_DURABLE };
+
+struct ImportReport {
+    ImportStatus status = ImportStatus::OK;
+    size_t rows = 0;
+    size_t badRow = 0;  // CSV line or binary record number of the first rejected row
+    int firstId = 0;
+};
+
+class DateTime {
+    static constexpr uint32_t kMinuteBits = 11;
+    uint32_t packed;
+
+    static uint32_t daysFromCivil(int y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        int era = (y >= 0 ? y : y - 399) / 400;
+        unsigned yoe = static_cast<unsigned>(y - era * 400);
+        unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return static_cast<uint32_t>(era * 146097 + static_cast<int>(doe) - 719468);
+    }
+
+    static void civilFromDays(uint32_t z, int& y, unsigned& m, unsigned& d) {
+        int days = static_cast<int>(z) + 719468;
+        int era = days / 146097;
+        unsigned doe = static_cast<unsigned>(days - era * 146097);
+        unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = static_cast<int>(yoe) + era * 400 + (m <= 2);
+    }
+
+    static bool digits(const char* s, int n, unsigned& out) {
+        out = 0;
+        for (int i = 0; i < n; ++i) {
+            unsigned c = static_cast<unsigned>(s[i] - '0');
+            if (c > 9) return false;
+            out = out * 10 + c;
+        }
+        return true;
+    }
+
+    static char* put(char* p, unsigned v, int width) {
+        for (int i = width - 1; i >= 0; --i, v /= 10) p[i] = static_cast<char>('0' + v % 10);
+        return p + width;
+    }
+
+public:
+    static constexpr size_t kFormattedSize = 16;
+
+    DateTime() : packed(0) {}
+    DateTime(uint32_t day, unsigned minute) : packed(day << kMinuteBits | minute) {}
+
+    static DateTime fromPacked(uint32_t packed) {
+        DateTime t;
+        t.packed = packed;
+        return t;
+    }
+
+    static DateTime fromTime(time_t t) {
+        tm local;
+        localtime_r(&t, &local);
+        return DateTime(daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday),
+                        local.tm_hour * 60 + local.tm_min);
+    }
+    static DateTime now() { return fromTime(time(0)); }
+
+    static DateTime nextOccurrence(ReserveDay target, DateTime from) {
+        unsigned ahead = (static_cast<unsigned>(target) + 7 - from.weekday()) % 7;
+        return DateTime(from.getDay() + ahead, 0);
+    }
+
+    // Accepts "YYYY-MM-DD" or "YYYY-MM-DD HH:MM".
+    static bool parse(const char* s, size_t len, DateTime& out) {
+        unsigned y, m, d, hh = 0, mm = 0;
+        if (len != 10 && len != 16) return false;
+        if (!digits(s, 4, y) || s[4] != '-' || !digits(s + 5, 2, m) || s[7] != '-' || !digits(s + 8, 2, d))
+            return false;
+        if (len == 16 && (s[10] != ' ' || !digits(s + 11, 2, hh) || s[13] != ':' || !digits(s + 14, 2, mm)))
+            return false;
+        if (y < 1970 || m < 1 || m > 12 || d < 1 || d > 31 || hh > 23 || mm > 59) return false;
+        out = DateTime(daysFromCivil(static_cast<int>(y), m, d), hh * 60 + mm);
+        return true;
+    }
+    static bool parse(const string& s, DateTime& out) { return parse(s.data(), s.size(), out); }
+
+    // Writes exactly kFormattedSize characters, "YYYY-MM-DD HH:MM", without a terminator.
+    char* format(char* buf) const {
+        int y;
+        unsigned m, d;
+        civilFromDays(getDay(), y, m, d);
+        char* p = put(buf, static_cast<unsigned>(y), 4);
+        *p++ = '-';
+        p = put(p, m, 2);
+        *p++ = '-';
+        p = put(p, d, 2);
+        *p++ = ' ';
+        p = put(p, getMinute() / 60, 2);
+        *p++ = ':';
+        return put(p, getMinute() % 60, 2);
+    }
+
+    uint32_t getDay() const { return packed >> kMinuteBits; }
+    unsigned getMinute() const { return packed & ((1u << kMinuteBits) - 1); }
+    uint32_t getPacked() const { return packed; }
+    unsigned weekday() const { return (getDay() + 5) % 7; }
+    bool isReserveDay() const { return weekday() <= static_cast<unsigned>(ReserveDay::WEDNESDAY); }
+    ReserveDay getReserveDay() const { return static_cast<ReserveDay>(weekday()); }
+
+    bool operator==(DateTime o) const { return packed == o.packed; }
+    bool operator!=(DateTime o) const { return packed != o.packed; }
+    bool operator<(DateTime o) const { return packed < o.packed; }
+    bool operator<=(DateTime o) const { return packed <= o.packed; }
+    bool operator>(DateTime o) const { return packed > o.packed; }
+    bool operator>=(DateTime o) const { return packed >= o.packed; }
+
+    friend ostream& operator<<(ostream& os, DateTime t) {
+        char buf[kFormattedSize];
+        t.format(buf);
+        return os.write(buf, kFormattedSize);
+    }
+};
+
+class Money {
+    int64_t cents;
+
+    explicit Money(int64_t c) : cents(c) {}
+
+public:
+    Money() : cents(0) {}
+
+    static Money fromCents(int64_t c) { return Money(c); }
+    static Money fromUnits(int64_t units) {
+        int64_t c;
+        if (__builtin_mul_overflow(units, int64_t(100), &c)) throw overflow_error("money overflow");
+        return Money(c);
+    }
+
+    // Accepts "12", "12.5", "-3.75"; more than two decimals is rejected rather than rounded.
+    static bool parse(const char* s, size_t len, Money& out) {
+        size_t i = 0;
+        bool negative = len > 0 && s[0] == '-';
+        if (negative) ++i;
+        int64_t whole = 0;
+        size_t digits = 0;
+        for (; i < len && s[i] >= '0' && s[i] <= '9'; ++i, ++digits)
+            if (__builtin_mul_overflow(whole, int64_t(10), &whole) || __builtin_add_overflow(whole, int64_t(s[i] - '0'), &whole))
+                return false;
+        int64_t fraction = 0;
+        int scale = 100;
+        if (i < len && s[i] == '.') {
+            for (++i; i < len && s[i] >= '0' && s[i] <= '9'; ++i, ++digits) {
+                if (scale == 1) return false;
+                scale /= 10;
+                fraction += (s[i] - '0') * scale;
+            }
+        }
+        if (i != len || digits == 0) return false;
+        int64_t c;
+        if (__builtin_mul_overflow(whole, int64_t(100), &c) || __builtin_add_overflow(c, fraction, &c)) return false;
+        out = Money(negative ? -c : c);
+        return true;
+    }
+    static bool parse(const string& s, Money& out) { return parse(s.data(), s.size(), out); }
+
+    int64_t getCents() const { return cents; }
+    bool isPositive() const { return cents > 0; }
+
+    Money operator+(Money o) const {
+        int64_t r;
+        if (__builtin_add_overflow(cents, o.cents, &r)) throw overflow_error("money overflow");
+        return Money(r);
+    }
+    Money operator-(Money o) const {
+        int64_t r;
+        if (__builtin_sub_overflow(cents, o.cents, &r)) throw overflow_error("money overflow");
+        return Money(r);
+    }
+    Money operator-() const { return Money(0) - *this; }
+    Money operator*(int64_t quantity) const {
+        int64_t r;
+        if (__builtin_mul_overflow(cents, quantity, &r)) throw overflow_error("money overflow");
+        return Money(r);
+    }
+    Money& operator+=(Money o) { return *this = *this + o; }
+    // Non-throwing +=; false, leaving the value untouched, if the sum does not fit.
+    bool tryAdd(Money o) {
+        int64_t r;
+        if (__builtin_add_overflow(cents, o.cents, &r)) return false;
+        cents = r;
+        return true;
+    }
+    Money& operator-=(Money o) { return *this = *this - o; }
+
+    bool operator==(Money o) const { return cents == o.cents; }
+    bool operator!=(Money o) const { return cents != o.cents; }
+    bool operator<(Money o) const { return cents < o.cents; }
+    bool operator<=(Money o) const { return cents <= o.cents; }
+    bool operator>(Money o) const { return cents > o.cents; }
+    bool operator>=(Money o) const { return cents >= o.cents; }
+
+    static constexpr size_t kMaxFormattedSize = 24;
+
+    // Writes the exact decimal form ("-12.50") and returns one past the last character, without a terminator.
+    char* format(char* out) const {
+        uint64_t magnitude = cents < 0 ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+        char buf[kMaxFormattedSize];
+        char* p = buf + sizeof(buf);
+        uint64_t fraction = magnitude % 100;
+        *--p = static_cast<char>('0' + fraction % 10);
+        *--p = static_cast<char>('0' + fraction / 10);
+        *--p = '.';
+        uint64_t whole = magnitude / 100;
+        do {
+            *--p = static_cast<char>('0' + whole % 10);
+            whole /= 10;
+        } while (whole);
+        if (cents < 0) *--p = '-';
+        size_t n = static_cast<size_t>(buf + sizeof(buf) - p);
+        memcpy(out, p, n);
+        return out + n;
+    }
+
+    friend ostream& operator<<(ostream& os, Money m) {
+        char buf[kMaxFormattedSize];
+        return os.write(buf, m.format(buf) - buf);
+    }
+};
+
+class Transaction {
+    uint64_t transactionID;
+    string trackingCode;
+    Money amount;
+    TransactionType type;
+    TransactionStatus status;
+    DateTime createdAt;
+
+public:
+    Transaction()
+        : transactionID(0), trackingCode(""), amount(),
+          type(TransactionType::PAYMENT), status(TransactionStatus::PENDING),
+          createdAt(DateTime::now()) {}
+
+    uint64_t getTransactionID() const { return transactionID; }
+    const string& getTrackingCode() const { return trackingCode; }
+    Money getAmount() const { return amount; }
+    TransactionType getType() const { return type; }
+    TransactionStatus getStatus() const { return status; }
+    DateTime getCreatedAt() const { return createdAt; }
+
+    void setTransactionID(uint64_t id) { transactionID = id; }
+    void setTrackingCode(string code) { trackingCode = move(code); }
+    void setAmount(Money amt) { amount = amt; }
+    void setType(TransactionType t) { type = t; }
+    void setStatus(TransactionStatus s) { status = s; }
+    void setCreatedAt(DateTime t) { createdAt = t; }
+};
+
+// Transactions evicted from a student's in-memory history, one append-only file of fixed records per student.
+class HistoryArchive {
+    struct Record {
+        uint64_t id;
+        int64_t amount;
+        uint32_t createdAt;
+        uint8_t type;
+        uint8_t status;
+        uint16_t codeLength;
+        char code[24];
+    };
+    static_assert(sizeof(Record) == 48, "archive records are written as raw 48-byte blocks");
+
+    string directory;
+
+    HistoryArchive() {}
+    HistoryArchive(const HistoryArchive&) = delete;
+    void operator=(const HistoryArchive&) = delete;
+
+    string pathFor(int userId) const { return directory + "/" + to_string(userId) + ".hist"; }
+
+public:
+    static HistoryArchive& instance() {
+        static HistoryArchive archiveInstance;
+        return archiveInstance;
+    }
+
+    void open(string dir) { directory = move(dir); }
+    bool isOpen() const { return !directory.empty(); }
+
+    bool append(int userId, const Transaction* items, size_t n) {
+        if (!isOpen()) return false;
+        vector<Record> records(n);
+        for (size_t i = 0; i < n; ++i) {
+            Record& r = records[i];
+            memset(&r, 0, sizeof(r));
+            r.id = items[i].getTransactionID();
+            r.amount = items[i].getAmount().getCents();
+            r.createdAt = items[i].getCreatedAt().getPacked();
+            r.type = static_cast<uint8_t>(items[i].getType());
+            r.status = static_cast<uint8_t>(items[i].getStatus());
+            r.codeLength = static_cast<uint16_t>(min(items[i].getTrackingCode().size(), sizeof(r.code)));
+            memcpy(r.code, items[i].getTrackingCode().data(), r.codeLength);
+        }
+        int fd = ::open(pathFor(userId).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return false;
+        size_t bytes = n * sizeof(Record);
+        bool ok = ::write(fd, records.data(), bytes) == static_cast<ssize_t>(bytes);
+        ::close(fd);
+        return ok;
+    }
+
+    // Drops anything past the first `count` records, e.g. entries a snapshot predates and WAL replay will spill again.
+    void truncate(int userId, uint64_t count) {
+        if (!isOpen()) return;
+        if (::truncate(pathFor(userId).c_str(), static_cast<off_t>(count * sizeof(Record))) != 0 && errno != ENOENT)
+            cout << "Failed to truncate history for student " << userId << endl;
+    }
+
+    // Page 0 holds the newest archived entries; each page is returned newest first.
+    bool page(int userId, size_t pageNo, size_t pageSize, vector<Transaction>& out) const {
+        out.clear();
+        int fd = ::open(pathFor(userId).c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        size_t count = fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) / sizeof(Record) : 0;
+        size_t skip = pageNo * pageSize;
+        if (skip >= count) {
+            ::close(fd);
+            return true;
+        }
+        size_t end = count - skip;
+        size_t begin = end > pageSize ? end - pageSize : 0;
+        vector<Record> records(end - begin);
+        size_t bytes = records.size() * sizeof(Record);
+        bool ok = pread(fd, records.data(), bytes, static_cast<off_t>(begin * sizeof(Record))) == static_cast<ssize_t>(bytes);
+        ::close(fd);
+        if (!ok) return false;
+        out.reserve(records.size());
+        for (size_t i = records.size(); i-- > 0;) {
+            const Record& r = records[i];
+            Transaction t;
+            t.setTransactionID(r.id);
+            t.setAmount(Money::fromCents(r.amount));
+            t.setCreatedAt(DateTime::fromPacked(r.createdAt));
+            t.setType(static_cast<TransactionType>(r.type));
+            t.setStatus(static_cast<TransactionStatus>(r.status));
+            t.setTrackingCode(string(r.code, r.codeLength));
+            out.push_back(move(t));
+        }
+        return true;
+    }
+};
+
+// Fixed-capacity ring of a student's latest transactions. When full, the older half is spilled to the archive.
+class TransactionHistory {
+public:
+    static constexpr size_t kCapacity = 32;
+
+private:
+    vector<Transaction> slots;
+    size_t head;
+    size_t count;
+    uint64_t archived;
+
+public:
+    TransactionHistory() : head(0), count(0), archived(0) {}
+
+    void reserve() {
+        if (slots.empty()) slots.resize(kCapacity);
+    }
+
+    void push(int userId, Transaction t) {
+        reserve();
+        if (count == kCapacity) {
+            // head only ever moves by half the capacity, so the oldest half is contiguous.
+            const size_t spill = kCapacity / 2;
+            if (HistoryArchive::instance().isOpen() && !HistoryArchive::instance().append(userId, &slots[head], spill))
+                cout << "Failed to archive history for student " << userId << endl;
+            head = (head + spill) % kCapacity;
+            count -= spill;
+            archived += spill;
+        }
+        slots[(head + count) % kCapacity] = move(t);
+        ++count;
+    }
+
+    size_t size() const { return count; }
+    uint64_t getArchived() const { return archived; }
+    void setArchived(uint64_t n) { archived = n; }
+
+    // Visits the latest `k` resident entries, oldest first.
+    template <typename F>
+    void forEachRecent(size_t k, F&& f) const {
+        size_t first = count > k ? count - k : 0;
+        for (size_t i = first; i < count; ++i) f(slots[(head + i) % kCapacity]);
+    }
+    template <typename F>
+    void forEach(F&& f) const { forEachRecent(count, f); }
+};
+
+// Structured event log. Producers copy a fixed-size record into their own thread's SPSC ring; a background
+// writer drains the rings, keeps each student's latest errors, and formats lines to the log file.
+class EventLog {
+public:
+    struct Record {
+        int64_t timestampNs;
+        int32_t studentId;
+        int32_t hallId;
+        uint32_t date;
+        EventCode code;
+        uint8_t mealType;
+        uint8_t reserved;
+    };
+    static_assert(sizeof(Record) == 24, "event records are copied as raw 24-byte blocks");
+
+    static constexpr size_t kRecentPerStudent = 16;
+
+private:
+    static constexpr size_t kRingSize = 4096;
+
+    struct Ring {
+        alignas(64) atomic<size_t> head{0};
+        alignas(64) atomic<size_t> tail{0};
+        Record slots[kRingSize];
+    };
+
+    struct RecentErrors {
+        Record items[kRecentPerStudent];
+        size_t count = 0;
+    };
+
+    mutex ringsLock;
+    vector<unique_ptr<Ring>> rings;
+    mutex drainLock;
+    unordered_map<int, RecentErrors> recent;
+    string pending;
+    int fd;
+    atomic<size_t> dropped;
+
+    thread writer;
+    mutex wakeLock;
+    condition_variable wake;
+    bool stopping;
+
+    EventLog() : fd(-1), dropped(0), stopping(false) {}
+    EventLog(const EventLog&) = delete;
+    void operator=(const EventLog&) = delete;
+
+    Ring& localRing() {
+        thread_local Ring* ring = nullptr;
+        if (!ring) {
+            lock_guard<mutex> guard(ringsLock);
+            rings.push_back(make_unique<Ring>());
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    void format(const Record& r) {
+        static const char* const meals[] = {"BREAKFAST", "LUNCH", "DINNER"};
+        time_t seconds = static_cast<time_t>(r.timestampNs / 1000000000);
+        char stamp[DateTime::kFormattedSize];
+        char date[DateTime::kFormattedSize];
+        DateTime::fromTime(seconds).format(stamp);
+        DateTime::fromPacked(r.date).format(date);
+        char line[160];
+        int n = snprintf(line, sizeof(line), "%.*s:%02d.%03d %s student=%d hall=%d date=%.10s meal=%s\n",
+                         static_cast<int>(sizeof(stamp)), stamp, static_cast<int>(seconds % 60),
+                         static_cast<int>(r.timestampNs / 1000000 % 1000), codeName(r.code), r.studentId,
+                         r.hallId, date, r.mealType < 3 ? meals[r.mealType] : "-");
+        if (n > 0) pending.append(line, min(static_cast<size_t>(n), sizeof(line) - 1));
+    }
+
+    // Caller holds drainLock, which makes this the single consumer of every ring.
+    void drainLocked() {
+        {
+            lock_guard<mutex> guard(ringsLock);
+            for (auto& ring : rings) {
+                size_t head = ring->head.load(memory_order_relaxed);
+                size_t tail = ring->tail.load(memory_order_acquire);
+                for (; head != tail; ++head) {
+                    const Record& r = ring->slots[head & (kRingSize - 1)];
+                    RecentErrors& errors = recent[r.studentId];
+                    errors.items[errors.count++ % kRecentPerStudent] = r;
+                    format(r);
+                }
+                ring->head.store(head, memory_order_release);
+            }
+        }
+        size_t done = 0;
+        while (fd >= 0 && done < pending.size()) {
+            ssize_t n = ::write(fd, pending.data() + done, pending.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += static_cast<size_t>(n);
+        }
+        pending.clear();
+    }
+
+    void writerLoop() {
+        unique_lock<mutex> lk(wakeLock);
+        while (!stopping) {
+            wake.wait_for(lk, chrono::milliseconds(20));
+            lk.unlock();
+            {
+                lock_guard<mutex> guard(drainLock);
+                drainLocked();
+            }
+            lk.lock();
+        }
+    }
+
+public:
+    static const char* codeName(EventCode code) {
+        switch (code) {
+            case EventCode::ALREADY_RESERVED: return "ALREADY_RESERVED";
+            case EventCode::HALL_FULL: return "HALL_FULL";
+            case EventCode::INSUFFICIENT_BALANCE: return "INSUFFICIENT_BALANCE";
+            case EventCode::INACTIVE_MEAL: return "INACTIVE_MEAL";
+            case EventCode::NOT_DURABLE: return "NOT_DURABLE";
+        }
+        return "UNKNOWN";
+    }
+
+    static EventLog& instance() {
+        static EventLog logInstance;
+        return logInstance;
+    }
+
+    bool open(const string& path) {
+        close();
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return false;
+        stopping = false;
+        writer = thread(&EventLog::writerLoop, this);
+        return true;
+    }
+
+    void close() {
+        if (writer.joinable()) {
+            {
+                lock_guard<mutex> lk(wakeLock);
+                stopping = true;
+            }
+            wake.notify_one();
+            writer.join();
+        }
+        lock_guard<mutex> guard(drainLock);
+        drainLocked();
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    // Never blocks: a full ring drops the event and counts it instead.
+    void log(EventCode code, int studentId, int hallId, DateTime date, MealType type) {
+        Ring& ring = localRing();
+        size_t tail = ring.tail.load(memory_order_relaxed);
+        if (tail - ring.head.load(memory_order_acquire) == kRingSize) {
+            dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        Record& r = ring.slots[tail & (kRingSize - 1)];
+        r.timestampNs = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        r.studentId = studentId;
+        r.hallId = hallId;
+        r.date = date.getPacked();
+        r.code = code;
+        r.mealType = static_cast<uint8_t>(type);
+        r.reserved = 0;
+        ring.tail.store(tail + 1, memory_order_release);
+    }
+
+    // Newest first. Drains the rings first so a student sees their own errors immediately.
+    void recentErrors(int studentId, vector<Record>& out) {
+        out.clear();
+        lock_guard<mutex> guard(drainLock);
+        drainLocked();
+        auto it = recent.find(studentId);
+        if (it == recent.end()) return;
+        const RecentErrors& errors = it->second;
+        size_t n = min(errors.count, kRecentPerStudent);
+        for (size_t i = 1; i <= n; ++i) out.push_back(errors.items[(errors.count - i) % kRecentPerStudent]);
+    }
+
+    size_t getDropped() const { return dropped.load(memory_order_relaxed); }
+};
 
 class User {
 protected:
@@ -21,26 +650,26 @@ string hashedPassword;
 
 public:
 User() : userId(0), name(""), lastName(""), hashedPassword("") {}
-User(int uid, const string& n, const string& l, const string& pass)
-: userId(uid), name(n), lastName(l), hashedPassword(pass) {}
+User(int uid, string n, string l, string pass)
+: userId(uid), name(move(n)), lastName(move(l)), hashedPassword(move(pass)) {}
 
 virtual void print() const {  
-    cout << "User Info:" << endl;  
-    cout << "User ID: " << userId << endl;  
-    cout << "Name: " << name << " " << lastName << endl;  
+    cout << "User Info:" << '\n';  
+    cout << "User ID: " << userId << '\n';  
+    cout << "Name: " << name << " " << lastName << '\n';  
 }  
 
-virtual string getType() const = 0;  
+virtual string_view getType() const = 0;  
 
 int getUserId() const { return userId; }  
-string getName() const { return name; }  
-string getLastName() const { return lastName; }  
-string getHashedPassword() const { return hashedPassword; }  
+const string& getName() const { return name; }  
+const string& getLastName() const { return lastName; }  
+const string& getHashedPassword() const { return hashedPassword; }  
 
 void setUserId(int id) { userId = id; }  
-void setName(const string& n) { name = n; }  
-void setLastName(const string& l) { lastName = l; }  
-void setHashedPassword(const string& pass) { hashedPassword = pass; }
+void setName(string n) { name = move(n); }  
+void setLastName(string l) { lastName = move(l); }  
+void setHashedPassword(string pass) { hashedPassword = move(pass); }
 
 };
 
@@ -53,86 +682,291 @@ class Student : public User {
 string studentId;
 string email;
 string phone;
-float accountBalance;
+int64_t balanceCents;
 bool isActive;
 vector<Reservation*> reservations;
-vector<Transaction> transactions;
-vector<string> errorLog;
+TransactionHistory transactions;
+// One bit per (date, meal type) with a seat held, for the kMealWindowDays starting at day activeFrom.
+// The window slides forward as reservations come in, dropping dates that have passed.
+uint64_t activeMeals;
+uint32_t activeFrom;
+
+bool mealBit(DateTime date, MealType type, uint64_t& bit) const {
+    uint32_t offset = date.getDay() - activeFrom;
+    if (date.getDay() < activeFrom || offset >= kMealWindowDays) return false;
+    bit = uint64_t(1) << (offset * 3 + static_cast<unsigned>(type));
+    return true;
+}
+
+void slideMealWindow(uint32_t day) {
+    if (day <= activeFrom) return;
+    uint64_t shift = uint64_t(day - activeFrom) * 3;
+    activeMeals = shift < 64 ? activeMeals >> shift : 0;
+    activeFrom = day;
+}
 
 public:
+static constexpr uint32_t kMealWindowDays = 21;
+
 Student()
-: User(), studentId(""), email(""), phone(""), accountBalance(0.0), isActive(true) {}
+: User(), studentId(""), email(""), phone(""), balanceCents(0), isActive(true), activeMeals(0), activeFrom(0) {}
 
-Student(int uid, const string& sid, const string& first, const string& last,  
-        const string& em, const string& ph, float bal, const string& pass)  
-    : User(uid, first, last, pass), studentId(sid), email(em), phone(ph),  
-      accountBalance(bal), isActive(true) {}  
+Student(int uid, string sid, string first, string last,  
+        string em, string ph, Money bal, string pass)  
+    : User(uid, move(first), move(last), move(pass)), studentId(move(sid)), email(move(em)), phone(move(ph)),  
+      balanceCents(bal.getCents()), isActive(true), activeMeals(0), activeFrom(0) {}  
 
 void print() const override {  
-    cout << "Student Info:" << endl;  
-    cout << "User ID: " << userId << endl;  
-    cout << "Student ID: " << studentId << endl;  
-    cout << "Name: " << name << " " << lastName << endl;  
-    cout << "Email: " << email << endl;  
-    cout << "Phone: " << phone << endl;  
-    cout << "Account: " << accountBalance << endl;  
-    cout << "Active: " << (isActive ? "Yes" : "No") << endl;  
+    cout << "Student Info:" << '\n';  
+    cout << "User ID: " << userId << '\n';  
+    cout << "Student ID: " << studentId << '\n';  
+    cout << "Name: " << name << " " << lastName << '\n';  
+    cout << "Email: " << email << '\n';  
+    cout << "Phone: " << phone << '\n';  
+    cout << "Account: " << getAccountBalance() << '\n';  
+    cout << "Active: " << (isActive ? "Yes" : "No") << '\n';  
 }
 
-string getType() const override { return "Student"; }  
+string_view getType() const override { return "Student"; }  
 
 void activate() { isActive = true; }  
 void deactivate() { isActive = false; }  
 bool getIsActive() const { return isActive; }  
 
-vector<Reservation*> getReserves() const { return reservations; }
-vector<Transaction> getTransactions() const { return transactions; }
-void addTransaction(const Transaction& t) { transactions.push_back(t); }
-void setAccountBalance(float b) { accountBalance = b; }
-float getAccountBalance() const { return accountBalance; }
+const string& getStudentId() const { return studentId; }
+const string& getEmail() const { return email; }
+const string& getPhone() const { return phone; }
+
+const vector<Reservation*>& getReserves() const { return reservations; }
+const TransactionHistory& getTransactions() const { return transactions; }
+void addTransaction(Transaction t) { transactions.push(userId, move(t)); }
+void restoreArchivedTransactions(uint64_t n) { transactions.setArchived(n); }
+void setAccountBalance(Money b) { __atomic_store_n(&balanceCents, b.getCents(), __ATOMIC_RELEASE); }
+Money getAccountBalance() const { return Money::fromCents(__atomic_load_n(&balanceCents, __ATOMIC_ACQUIRE)); }
+
+// Balance changes go through these CAS loops so a concurrent top-up and checkout never lose an update.
+// A credit that would overflow the balance is refused and leaves it untouched.
+bool credit(Money amount) {
+    int64_t current = __atomic_load_n(&balanceCents, __ATOMIC_RELAXED);
+    int64_t next;
+    do {
+        if (__builtin_add_overflow(current, amount.getCents(), &next)) return false;
+    } while (!__atomic_compare_exchange_n(&balanceCents, &current, next, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    return true;
+}
+bool tryDebit(Money amount) {
+    int64_t current = __atomic_load_n(&balanceCents, __ATOMIC_RELAXED);
+    do {
+        if (current < amount.getCents()) return false;
+    } while (!__atomic_compare_exchange_n(&balanceCents, &current, current - amount.getCents(), true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    return true;
+}
+
+bool hasActiveReservationFor(DateTime date, MealType type) const {
+    uint64_t bit;
+    return mealBit(date, type, bit) && (activeMeals & bit);
+}
+void addReservation(Reservation* reservation);
+void reserveHistory(size_t extraReservations, size_t extraTransactions) {
+    if (reservations.capacity() < reservations.size() + extraReservations)
+        reservations.reserve(max(reservations.capacity() * 2, reservations.size() + extraReservations));
+    if (extraTransactions) transactions.reserve();
+}
+bool cancelReservation(Reservation* reservation);
+// Cancels without giving the seat up; the caller decides where it goes.
+bool revokeReservation(Reservation* reservation);
 
 };
 
 class Admin : public User {
 public:
 Admin() : User() {}
-Admin(int uid, const string& n, const string& l, const string& pass)
-: User(uid, n, l, pass) {}
+Admin(int uid, string n, string l, string pass)
+: User(uid, move(n), move(l), move(pass)) {}
 
 void print() const override {  
-    cout << "Admin Info:" << endl;  
-    cout << "User ID: " << userId << endl;  
-    cout << "Name: " << name << " " << lastName << endl;  
+    cout << "Admin Info:" << '\n';  
+    cout << "User ID: " << userId << '\n';  
+    cout << "Name: " << name << " " << lastName << '\n';  
 }  
 
-string getType() const override { return "Admin"; }
+string_view getType() const override { return "Admin"; }
+
+bool updateMealPrice(int mealId, Money price);
+bool deactivateMeal(int mealId);
+bool activateMeal(int mealId);
+// Logged like every other admin change; false if the user id is taken.
+bool addStudent(Student student);
+
+// Semester setup: bulk loads and dumps of the menu and hall list (see BulkCatalog for the formats).
+bool importMeals(const string& path, ImportReport& report);
+bool importHalls(const string& path, ImportReport& report);
+bool importStudents(const string& path, ImportReport& report);
+bool importStaff(const string& path, ImportReport& report);
+bool exportMeals(const string& path, BulkFormat format);
+bool exportHalls(const string& path, BulkFormat format);
+
+};
+// Process-wide pool of immutable strings shared by the menu. Interning takes a lock; turning an id back into
+// text never does, and interned characters never move, so the views stay valid for the life of the process.
+class StringTable {
+    static constexpr size_t kChunkShift = 12;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkShift;
+    static constexpr size_t kMaxChunks = size_t(1) << 14;
+    static constexpr size_t kArenaBlock = 64 * 1024;
+
+    // Open-addressing set of ids; the cached hash spares most string compares and all rehash work.
+    struct Bucket {
+        uint32_t id;
+        uint32_t hash;
+    };
+
+    array<atomic<string_view*>, kMaxChunks> chunks;
+    uint32_t count;
+    mutex lock;
+    vector<Bucket> buckets;
+    size_t mask;
+    vector<unique_ptr<char[]>> arena;
+    char* arenaNext;
+    size_t arenaLeft;
+
+    StringTable() : count(0), buckets(1024, Bucket{kEmpty, 0}), mask(1023), arenaNext(nullptr), arenaLeft(0) {
+        for (auto& c : chunks) c.store(nullptr, memory_order_relaxed);
+        store(string_view(), 0);
+    }
+    StringTable(const StringTable&) = delete;
+    void operator=(const StringTable&) = delete;
+
+    static uint32_t hashOf(string_view s) {
+        uint32_t h = 2166136261u;
+        for (char c : s) h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+        return h;
+    }
+
+    Bucket& bucketFor(string_view s, uint32_t hash) {
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Bucket& b = buckets[i];
+            if (b.id == kEmpty || (b.hash == hash && view(b.id) == s)) return b;
+        }
+    }
+
+    void grow() {
+        vector<Bucket> old(buckets.size() * 2, Bucket{kEmpty, 0});
+        old.swap(buckets);
+        mask = buckets.size() - 1;
+        for (const Bucket& b : old) {
+            if (b.id == kEmpty) continue;
+            size_t i = b.hash & mask;
+            while (buckets[i].id != kEmpty) i = (i + 1) & mask;
+            buckets[i] = b;
+        }
+    }
+
+    ~StringTable() {
+        for (auto& c : chunks) delete[] c.load(memory_order_relaxed);
+    }
+
+    // Copies the text into the arena and appends it; the caller holds the lock (or is the constructor).
+    uint32_t store(string_view s, uint32_t hash) {
+        if (count == kMaxChunks * kChunkSize) throw length_error("string table full");
+        const char* text = nullptr;
+        if (!s.empty()) {
+            if (s.size() > arenaLeft) {
+                size_t block = max(kArenaBlock, s.size());
+                arena.emplace_back(new char[block]);
+                arenaNext = arena.back().get();
+                arenaLeft = block;
+            }
+            memcpy(arenaNext, s.data(), s.size());
+            text = arenaNext;
+            arenaNext += s.size();
+            arenaLeft -= s.size();
+        }
+        size_t chunk = count >> kChunkShift;
+        string_view* slots = chunks[chunk].load(memory_order_relaxed);
+        if (!slots) {
+            slots = new string_view[kChunkSize];
+            chunks[chunk].store(slots, memory_order_release);
+        }
+        slots[count & (kChunkSize - 1)] = string_view(text, s.size());
+        if (count != kEmpty) {
+            if ((count + 1) * 10 > buckets.size() * 7) grow();
+            bucketFor(s, hash) = Bucket{count, hash};
+        }
+        return count++;
+    }
+
+public:
+    static constexpr uint32_t kEmpty = 0;
+
+    static StringTable& instance() {
+        static StringTable tableInstance;
+        return tableInstance;
+    }
+
+    uint32_t intern(string_view s) {
+        if (s.empty()) return kEmpty;
+        uint32_t hash = hashOf(s);
+        lock_guard<mutex> guard(lock);
+        Bucket& b = bucketFor(s, hash);
+        return b.id != kEmpty ? b.id : store(s, hash);
+    }
+
+    // Looks a string up without adding it; text nobody interned matches no id.
+    bool find(string_view s, uint32_t& id) {
+        if (s.empty()) {
+            id = kEmpty;
+            return true;
+        }
+        uint32_t hash = hashOf(s);
+        lock_guard<mutex> guard(lock);
+        const Bucket& b = bucketFor(s, hash);
+        if (b.id == kEmpty) return false;
+        id = b.id;
+        return true;
+    }
+
+    string_view view(uint32_t id) const {
+        return chunks[id >> kChunkShift].load(memory_order_acquire)[id & (kChunkSize - 1)];
+    }
 
+    size_t size() {
+        lock_guard<mutex> guard(lock);
+        return count;
+    }
 };
+
 class Meal {
+public:
+    static constexpr size_t kMaxSideItems = 8;
+
+private:
     int mealId;
-    string name;
-    float price;
+    uint32_t nameId;
+    int64_t priceCents;
     bool isActive;
     MealType mealType;
     ReserveDay reserveDay;
-    vector<string> sideItems;
+    uint8_t sideCount;
+    array<uint32_t, kMaxSideItems> sideItems;
 
 public:
     Meal()
-    : mealId(0), name(""), price(0.0), isActive(true),
-    mealType(MealType::LUNCH), reserveDay(ReserveDay::SATURDAY) {}
+    : mealId(0), nameId(StringTable::kEmpty), priceCents(0), isActive(true),
+    mealType(MealType::LUNCH), reserveDay(ReserveDay::SATURDAY), sideCount(0), sideItems{} {}
 
     void print() const {  
-        cout << "Meal ID: " << mealId << endl;  
-        cout << "Name: " << name << endl;  
-        cout << "Price: " << price << endl;  
+        cout << "Meal ID: " << mealId << '\n';  
+        cout << "Name: " << getName() << '\n';  
+        cout << "Price: " << getPrice() << '\n';  
         cout << "Type: ";  
         switch (mealType) {  
             case MealType::BREAKFAST: cout << "Breakfast"; break;  
             case MealType::LUNCH: cout << "Lunch"; break;  
             case MealType::DINNER: cout << "Dinner"; break;  
         }  
-        cout << endl;  
+        cout << '\n';  
         cout << "Reserve Day: ";  
         switch (reserveDay) {  
             case ReserveDay::SATURDAY: cout << "Saturday"; break;  
@@ -141,30 +975,44 @@ public:
             case ReserveDay::TUESDAY: cout << "Tuesday"; break;  
             case ReserveDay::WEDNESDAY: cout << "Wednesday"; break;  
         }  
-        cout << endl;  
-        cout << "Active: " << (isActive ? "Yes" : "No") << endl;  
+        cout << '\n';  
+        cout << "Active: " << (getIsActive() ? "Yes" : "No") << '\n';  
         cout << "Side Items: ";  
-        for (auto& item : sideItems) cout << item << " ";  
-        cout << endl;  
+        for (size_t i = 0; i < sideCount; ++i) cout << getSideItem(i) << " ";  
+        cout << '\n';  
     }
 
-    void activate() { isActive = true; }  
-    void deactivate() { isActive = false; }  
-    bool getIsActive() const { return isActive; }  
+    // Price and availability change while menus are being read; MenuCatalog publishes the changes.
+    void activate() { __atomic_store_n(&isActive, true, __ATOMIC_RELEASE); }  
+    void deactivate() { __atomic_store_n(&isActive, false, __ATOMIC_RELEASE); }  
+    bool getIsActive() const { return __atomic_load_n(&isActive, __ATOMIC_ACQUIRE); }  
 
-    void addSideItem(const string& item) { sideItems.push_back(item); }  
-    void updatePrice(float newPrice) { price = newPrice; }  
+    // Side items and names are interned, so comparing them is comparing ids. False once the meal is full.
+    bool addSideItem(string_view item) {
+        if (sideCount == kMaxSideItems) return false;
+        sideItems[sideCount++] = StringTable::instance().intern(item);
+        return true;
+    }
+    bool hasSideItem(uint32_t id) const {
+        for (size_t i = 0; i < sideCount; ++i)
+            if (sideItems[i] == id) return true;
+        return false;
+    }
+    void updatePrice(Money newPrice) { __atomic_store_n(&priceCents, newPrice.getCents(), __ATOMIC_RELEASE); }  
 
     int getMealId() const { return mealId; }  
-    string getName() const { return name; }  
-    float getPrice() const { return price; }  
+    string_view getName() const { return StringTable::instance().view(nameId); }  
+    uint32_t getNameId() const { return nameId; }  
+    Money getPrice() const { return Money::fromCents(__atomic_load_n(&priceCents, __ATOMIC_ACQUIRE)); }  
     MealType getMealType() const { return mealType; }  
     ReserveDay getReserveDay() const { return reserveDay; }  
-    vector<string> getSideItems() const { return sideItems; }  
+    size_t getSideItemCount() const { return sideCount; }  
+    uint32_t getSideItemId(size_t i) const { return sideItems[i]; }  
+    string_view getSideItem(size_t i) const { return StringTable::instance().view(sideItems[i]); }  
 
     void setMealId(int id) { mealId = id; }  
-    void setName(const string& n) { name = n; }  
-    void setPrice(float p) { price = p; }  
+    void setName(string_view n) { nameId = StringTable::instance().intern(n); }  
+    void setPrice(Money p) { priceCents = p.getCents(); }  
     void setMealType(MealType type) { mealType = type; }  
     void setReserveDay(ReserveDay day) { reserveDay = day; }
 };
@@ -179,167 +1027,3359 @@ public:
     DiningHall() : hallId(0), name(""), address(""), capacity(0) {}
 
     void print() const {  
-        cout << "Dining Hall ID: " << hallId << endl;  
-        cout << "Name: " << name << endl;  
-        cout << "Address: " << address << endl;  
-        cout << "Capacity: " << capacity << endl;  
+        cout << "Dining Hall ID: " << hallId << '\n';  
+        cout << "Name: " << name << '\n';  
+        cout << "Address: " << address << '\n';  
+        cout << "Capacity: " << capacity << '\n';  
     }  
 
     int getHallId() const { return hallId; }  
-    string getName() const { return name; }  
-    string getAddress() const { return address; }  
+    const string& getName() const { return name; }  
+    const string& getAddress() const { return address; }  
     int getCapacity() const { return capacity; }  
 
     void setHallId(int id) { hallId = id; }  
-    void setName(const string& n) { name = n; }  
-    void setAddress(const string& addr) { address = addr; }  
+    void setName(string n) { name = move(n); }  
+    void setAddress(string addr) { address = move(addr); }  
     void setCapacity(int cap) { capacity = cap; }
 };
 
+class ReservationTable;
+
 class Reservation {
-    int reservationId;
+    uint64_t reservationId;
     DiningHall* diningHall;
     Meal* meal;
     RStatus status;
-    time_t createdAt;
+    DateTime createdAt;
+    DateTime date;
+    ReservationTable* table;
+    uint32_t row;
 
 public:
     Reservation()
     : reservationId(0), diningHall(nullptr), meal(nullptr),
-    status(RStatus::SUCCESS), createdAt(time(0)) {}
+    status(RStatus::SUCCESS), createdAt(DateTime::now()), date(createdAt.getDay(), 0),
+    table(nullptr), row(0) {}
 
-    Reservation(int id, DiningHall* hall, Meal* m)  
+    Reservation(uint64_t id, DiningHall* hall, Meal* m)  
     : reservationId(id), diningHall(hall), meal(m),  
-      status(RStatus::SUCCESS), createdAt(time(0)) {}
+      status(RStatus::SUCCESS), createdAt(DateTime::now()),
+      date(m ? DateTime::nextOccurrence(m->getReserveDay(), createdAt) : DateTime(createdAt.getDay(), 0)),
+      table(nullptr), row(0) {}
 
     void print() const {  
-        cout << "Reservation ID: " << reservationId << endl;  
+        cout << "Reservation ID: " << reservationId << '\n';  
         cout << "Status: ";  
         switch (status) {  
             case RStatus::SUCCESS: cout << "Success"; break;  
             case RStatus::CANCELLED: cout << "Cancelled"; break;  
             case RStatus::FAILED: cout << "Failed"; break;  
             case RStatus::NOT_PAID: cout << "Not Paid"; break;
+            case RStatus::CHECKED_IN: cout << "Checked In"; break;
         }  
-        cout << endl;  
-        cout << "Created At: " << ctime(&createdAt);  
+        cout << '\n';  
+        cout << "Created At: " << createdAt << '\n';
+        cout << "Date: " << date << '\n';
     }  
 
-    RStatus getStatus() const { return status; }  
-    void setStatus(RStatus s) { status = s; }
-    int getReservationId() const { return reservationId; }  
+    RStatus getStatus() const { return __atomic_load_n(&status, __ATOMIC_ACQUIRE); }  
+    inline void setStatus(RStatus s);
+    // Compare-and-swap on the status, so a cancel and a door check-in racing on one ticket cannot both win.
+    inline bool transition(RStatus from, RStatus to);
+    static bool holdsSeat(RStatus s) { return s == RStatus::SUCCESS || s == RStatus::CHECKED_IN; }
+    uint64_t getReservationId() const { return reservationId; }  
     Meal* getMeal() const { return meal; }  
     DiningHall* getDiningHall() const { return diningHall; }  
-    time_t getCreatedAt() const { return createdAt; }  
+    DateTime getCreatedAt() const { return createdAt; }  
+    DateTime getDate() const { return date; }
 
-    void setReservationId(int id) { reservationId = id; }  
-    void setMeal(Meal* m) { meal = m; }  
+    void setReservationId(uint64_t id) { reservationId = id; }  
+    void setMeal(Meal* m) {
+        meal = m;
+        if (m) date = DateTime::nextOccurrence(m->getReserveDay(), createdAt);
+    }
     void setDiningHall(DiningHall* d) { diningHall = d; }
+    void setCreatedAt(DateTime t) { createdAt = t; }
+    void setDate(DateTime d) { date = d; }
+
+    void attach(ReservationTable* t, uint32_t r) { table = t; row = r; }
+    uint32_t getRow() const { return row; }
 };
 
-class Storage {
-    int mealIdCounter;
-    int diningHallIdCounter;
-    vector<Meal> allMeals;
-    vector<DiningHall> allDiningHalls;
+template <typename Chunk, size_t kChunkShift>
+class ChunkedColumns {
+public:
+    static constexpr size_t kChunkRows = size_t(1) << kChunkShift;
+    static constexpr size_t kMaxChunks = size_t(1) << 14;
 
-    Storage() : mealIdCounter(1), diningHallIdCounter(1) {}
-    Storage(const Storage&) = delete;
-    void operator=(const Storage&) = delete;
+private:
+    unique_ptr<atomic<Chunk*>[]> chunks;
+    atomic<size_t> rows;
 
 public:
-    static Storage& instance() {
-        static Storage storageInstance;
-        return storageInstance;
+    ChunkedColumns() : chunks(new atomic<Chunk*>[kMaxChunks]), rows(0) {
+        for (size_t i = 0; i < kMaxChunks; ++i) chunks[i].store(nullptr, memory_order_relaxed);
     }
+    ChunkedColumns(const ChunkedColumns&) = delete;
+    ChunkedColumns& operator=(const ChunkedColumns&) = delete;
 
-    int generateMealId() { return mealIdCounter++; }
-    int generateDiningHallId() { return diningHallIdCounter++; }
-
-    void addMeal(const Meal& meal) { allMeals.push_back(meal); }
-    void addDiningHall(const DiningHall& hall) { allDiningHalls.push_back(hall); }
-
-    vector<Meal>& getMeals() { return allMeals; }
-    vector<DiningHall>& getDiningHalls() { return allDiningHalls; }
-};
+    ~ChunkedColumns() {
+        for (size_t i = 0; i < kMaxChunks; ++i) delete chunks[i].load(memory_order_relaxed);
+    }
 
-class Transaction {
-    int transactionID;
-    string trackingCode;
-    float amount;
-    TransactionType type;
-    TransactionStatus status;
-    time_t createdAt;
+    // Appends must be serialized by the caller; scans may run concurrently and see every row
+    // published before they read size(). fill(chunk, index) writes the new row's columns.
+    template <typename F>
+    uint32_t append(F&& fill) {
+        size_t r = rows.load(memory_order_relaxed);
+        if ((r >> kChunkShift) >= kMaxChunks) throw length_error("columnar table is full");
+        Chunk* c = chunks[r >> kChunkShift].load(memory_order_relaxed);
+        if (!c) {
+            c = new Chunk;
+            chunks[r >> kChunkShift].store(c, memory_order_release);
+        }
+        fill(*c, r & (kChunkRows - 1));
+        rows.store(r + 1, memory_order_release);
+        return static_cast<uint32_t>(r);
+    }
 
-public:
-    Transaction()
-        : transactionID(0), trackingCode(""), amount(0.0),
-          type(TransactionType::PAYMENT), status(TransactionStatus::PENDING),
-          createdAt(time(0)) {}
+    Chunk& chunkFor(uint32_t row) { return *chunks[row >> kChunkShift].load(memory_order_acquire); }
+    static size_t indexOf(uint32_t row) { return row & (kChunkRows - 1); }
 
-    int getTransactionID() const { return transactionID; }
-    string getTrackingCode() const { return trackingCode; }
-    float getAmount() const { return amount; }
-    TransactionType getType() const { return type; }
-    TransactionStatus getStatus() const { return status; }
-    time_t getCreatedAt() const { return createdAt; }
+    size_t size() const { return rows.load(memory_order_acquire); }
 
-    void setTransactionID(int id) { transactionID = id; }
-    void setTrackingCode(const string& code) { trackingCode = code; }
-    void setAmount(float amt) { amount = amt; }
-    void setType(TransactionType t) { type = t; }
-    void setStatus(TransactionStatus s) { status = s; }
-    void setCreatedAt(time_t t) { createdAt = t; }
+    // Calls f(chunk, rowsInChunk) for every published chunk, in row order.
+    template <typename F>
+    void forEachChunk(F&& f) const {
+        size_t total = size();
+        for (size_t c = 0; c * kChunkRows < total; ++c)
+            f(*chunks[c].load(memory_order_acquire), min(kChunkRows, total - c * kChunkRows));
+    }
 };
 
-class IDGenerator {
-    static int reservationCounter;
-    static int transactionCounter;
-
+class ReservationTable {
 public:
-    static int generateReservationId() { return reservationCounter++; }
-    static int generateTransactionId() { return transactionCounter++; }
-};
+    static constexpr size_t kChunkRows = size_t(1) << 16;
 
-int IDGenerator::reservationCounter = 1;
-int IDGenerator::transactionCounter = 1000;
+    struct Chunk {
+        uint64_t reservationIds[kChunkRows];
+        int32_t studentIds[kChunkRows];
+        int32_t mealIds[kChunkRows];
+        int32_t hallIds[kChunkRows];
+        uint32_t dates[kChunkRows];
+        uint32_t createdAt[kChunkRows];
+        int64_t prices[kChunkRows];
+        uint8_t days[kChunkRows];
+        uint8_t mealTypes[kChunkRows];
+        uint8_t statuses[kChunkRows];
+    };
 
-class ShoppingCart {
-    vector<Reservation> reservations;
+private:
+    ChunkedColumns<Chunk, 16> columns;
 
 public:
-    void addReservation(const Reservation& reservation) {
-        reservations.push_back(reservation);
+    uint32_t append(const Reservation& res, int studentId) {
+        return columns.append([&](Chunk& c, size_t i) {
+            Meal* meal = res.getMeal();
+            c.reservationIds[i] = res.getReservationId();
+            c.studentIds[i] = studentId;
+            c.mealIds[i] = meal->getMealId();
+            c.hallIds[i] = res.getDiningHall()->getHallId();
+            c.dates[i] = res.getDate().getDay();
+            c.createdAt[i] = res.getCreatedAt().getPacked();
+            c.prices[i] = meal->getPrice().getCents();
+            c.days[i] = static_cast<uint8_t>(meal->getReserveDay());
+            c.mealTypes[i] = static_cast<uint8_t>(meal->getMealType());
+            c.statuses[i] = static_cast<uint8_t>(res.getStatus());
+        });
     }
 
-    void removeReservation(int id) {
-        for (auto it = reservations.begin(); it != reservations.end(); ++it) {
-            if (it->getReservationId() == id) {
-                reservations.erase(it);
-                break;
-            }
-        }
+    void setStatus(uint32_t row, RStatus status) {
+        __atomic_store_n(&columns.chunkFor(row).statuses[columns.indexOf(row)], static_cast<uint8_t>(status), __ATOMIC_RELAXED);
     }
 
-    void viewShoppingCartItems() const {
-        cout << "Shopping Cart Items:" << endl;
-        for (const auto& res : reservations) {
-            res.print();
-            cout << "------------------------" << endl;
-        }
-    }
+    size_t size() const { return columns.size(); }
 
-    void clear() {
-        reservations.clear();
-    }
+    template <typename F>
+    void forEachChunk(F&& f) const { columns.forEachChunk(std::forward<F>(f)); }
 
-    vector<Reservation> getReservations() const {
-        return reservations;
+    size_t countActive(int hallId, ReserveDay day, MealType type) const {
+        size_t count = 0;
+        uint8_t d = static_cast<uint8_t>(day);
+        uint8_t t = static_cast<uint8_t>(type);
+        uint8_t ok = static_cast<uint8_t>(RStatus::SUCCESS);
+        uint8_t in = static_cast<uint8_t>(RStatus::CHECKED_IN);
+        forEachChunk([&](const Chunk& c, size_t n) {
+            for (size_t i = 0; i < n; ++i)
+                count += (c.hallIds[i] == hallId) & (c.days[i] == d) & (c.mealTypes[i] == t) &
+                         ((c.statuses[i] == ok) | (c.statuses[i] == in));
+        });
+        return count;
+    }
+};
+
+class TransactionTable {
+public:
+    static constexpr size_t kChunkRows = size_t(1) << 16;
+
+    struct Chunk {
+        uint64_t transactionIds[kChunkRows];
+        int32_t studentIds[kChunkRows];
+        int64_t amounts[kChunkRows];
+        uint32_t createdAt[kChunkRows];
+        uint8_t types[kChunkRows];
+        uint8_t statuses[kChunkRows];
+    };
+
+private:
+    ChunkedColumns<Chunk, 16> columns;
+
+public:
+    uint32_t append(const Transaction& t, int studentId) {
+        return columns.append([&](Chunk& c, size_t i) {
+            c.transactionIds[i] = t.getTransactionID();
+            c.studentIds[i] = studentId;
+            c.amounts[i] = t.getAmount().getCents();
+            c.createdAt[i] = t.getCreatedAt().getPacked();
+            c.types[i] = static_cast<uint8_t>(t.getType());
+            c.statuses[i] = static_cast<uint8_t>(t.getStatus());
+        });
+    }
+
+    size_t size() const { return columns.size(); }
+
+    template <typename F>
+    void forEachChunk(F&& f) const { columns.forEachChunk(std::forward<F>(f)); }
+};
+
+void Reservation::setStatus(RStatus s) {
+    __atomic_store_n(&status, s, __ATOMIC_RELEASE);
+    if (table) table->setStatus(row, s);
+}
+
+bool Reservation::transition(RStatus from, RStatus to) {
+    if (!__atomic_compare_exchange_n(&status, &from, to, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return false;
+    if (table) table->setStatus(row, to);
+    return true;
+}
+
+// Global reservationId -> reservation map with owner and hall back-references. Sharded so door scans and
+// cancellations only contend with writers that hash to the same shard, and readers share the shard lock.
+class ReservationIndex {
+public:
+    struct Entry {
+        uint64_t id = 0;
+        Reservation* reservation = nullptr;
+        int studentId = 0;
+        int hallId = 0;
+    };
+
+private:
+    static constexpr size_t kShards = 64;
+
+    struct alignas(64) Shard {
+        mutable shared_mutex lock;
+        vector<Entry> slots = vector<Entry>(64);
+        size_t count = 0;
+    };
+
+    array<Shard, kShards> shards;
+
+    static uint64_t mix(uint64_t id) { return id * 0x9E3779B97F4A7C15ull; }
+    Shard& shardFor(uint64_t id) { return shards[mix(id) >> 58]; }
+    const Shard& shardFor(uint64_t id) const { return shards[mix(id) >> 58]; }
+
+    // Returns true when the id was not present before.
+    static bool place(vector<Entry>& slots, const Entry& e) {
+        size_t mask = slots.size() - 1;
+        size_t i = mix(e.id) & mask;
+        while (slots[i].reservation && slots[i].id != e.id) i = (i + 1) & mask;
+        bool added = !slots[i].reservation;
+        slots[i] = e;
+        return added;
+    }
+
+public:
+    void insert(Reservation* reservation, int studentId) {
+        Entry e;
+        e.id = reservation->getReservationId();
+        e.reservation = reservation;
+        e.studentId = studentId;
+        e.hallId = reservation->getDiningHall() ? reservation->getDiningHall()->getHallId() : 0;
+        Shard& shard = shardFor(e.id);
+        unique_lock<shared_mutex> guard(shard.lock);
+        if ((shard.count + 1) * 10 > shard.slots.size() * 7) {
+            vector<Entry> grown(shard.slots.size() * 2);
+            for (const auto& old : shard.slots)
+                if (old.reservation) place(grown, old);
+            shard.slots.swap(grown);
+        }
+        if (place(shard.slots, e)) ++shard.count;
+    }
+
+    bool find(uint64_t id, Entry& out) const {
+        const Shard& shard = shardFor(id);
+        shared_lock<shared_mutex> guard(shard.lock);
+        size_t mask = shard.slots.size() - 1;
+        for (size_t i = mix(id) & mask; shard.slots[i].reservation; i = (i + 1) & mask) {
+            if (shard.slots[i].id == id) {
+                out = shard.slots[i];
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Open-addressing id -> slot map. Inserts must be serialized by the caller; find() may run concurrently. A bucket's
+// key is written before its slot is published, and a grown table is filled before it replaces the old one, which
+// is kept until the index goes away since a reader may still be probing it.
+class IdIndex {
+    struct Table {
+        size_t mask;
+        unique_ptr<int[]> keys;
+        unique_ptr<atomic<size_t>[]> slots;
+
+        explicit Table(size_t buckets)
+            : mask(buckets - 1), keys(new int[buckets]()), slots(new atomic<size_t>[buckets]) {
+            for (size_t i = 0; i < buckets; ++i) slots[i].store(npos, memory_order_relaxed);
+        }
+        size_t buckets() const { return mask + 1; }
+    };
+
+    vector<unique_ptr<Table>> tables;
+    atomic<Table*> current;
+    size_t count;
+
+    static size_t bucket(const Table& t, int id) {
+        return (static_cast<uint32_t>(id) * 2654435769u) & t.mask;
+    }
+
+    // Returns true if the key is new.
+    static bool place(Table& t, int id, size_t slot) {
+        size_t i = bucket(t, id);
+        while (t.slots[i].load(memory_order_relaxed) != npos && t.keys[i] != id) i = (i + 1) & t.mask;
+        bool added = t.slots[i].load(memory_order_relaxed) == npos;
+        t.keys[i] = id;
+        t.slots[i].store(slot, memory_order_release);
+        return added;
+    }
+
+    void grow(size_t buckets) {
+        const Table& old = *tables.back();
+        auto next = make_unique<Table>(buckets);
+        for (size_t i = 0; i < old.buckets(); ++i) {
+            size_t slot = old.slots[i].load(memory_order_relaxed);
+            if (slot != npos) place(*next, old.keys[i], slot);
+        }
+        current.store(next.get(), memory_order_release);
+        tables.push_back(move(next));
+    }
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    IdIndex() : count(0) {
+        tables.push_back(make_unique<Table>(16));
+        current.store(tables.back().get(), memory_order_relaxed);
+    }
+    IdIndex(const IdIndex&) = delete;
+    IdIndex& operator=(const IdIndex&) = delete;
+
+    void insert(int id, size_t slot) {
+        if ((count + 1) * 10 > tables.back()->buckets() * 7) grow(tables.back()->buckets() * 2);
+        if (place(*tables.back(), id, slot)) ++count;
+    }
+
+    // Sizes the table for n keys in one rehash.
+    void reserve(size_t n) {
+        size_t buckets = tables.back()->buckets();
+        while (n * 10 > buckets * 7) buckets *= 2;
+        if (buckets != tables.back()->buckets()) grow(buckets);
+    }
+
+    size_t find(int id) const {
+        const Table& t = *current.load(memory_order_acquire);
+        for (size_t i = bucket(t, id);; i = (i + 1) & t.mask) {
+            size_t slot = t.slots[i].load(memory_order_acquire);
+            if (slot == npos || t.keys[i] == id) return slot;
+        }
+    }
+
+    size_t size() const { return count; }
+};
+
+// Appends must be serialized by the caller; indexing may run concurrently. Chunks never move and are published
+// through atomic pointers, like ChunkedColumns, and size() only counts fully constructed elements.
+template <typename T>
+class StableVector {
+    static constexpr size_t kChunkShift = 10;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkShift;
+    static constexpr size_t kMaxChunks = size_t(1) << 16;
+
+    unique_ptr<atomic<T*>[]> chunks;
+    size_t allocated;
+    atomic<size_t> count;
+
+    void addChunk() {
+        if (allocated == kMaxChunks) throw length_error("stable vector is full");
+        chunks[allocated].store(static_cast<T*>(::operator new(sizeof(T) * kChunkSize)), memory_order_release);
+        ++allocated;
+    }
+
+public:
+    class iterator {
+        StableVector* owner;
+        size_t pos;
+
+    public:
+        iterator(StableVector* o, size_t p) : owner(o), pos(p) {}
+        T& operator*() const { return (*owner)[pos]; }
+        T* operator->() const { return &(*owner)[pos]; }
+        iterator& operator++() { ++pos; return *this; }
+        bool operator!=(const iterator& other) const { return pos != other.pos; }
+        bool operator==(const iterator& other) const { return pos == other.pos; }
+    };
+
+    StableVector() : chunks(new atomic<T*>[kMaxChunks]), allocated(0), count(0) {
+        for (size_t i = 0; i < kMaxChunks; ++i) chunks[i].store(nullptr, memory_order_relaxed);
+    }
+    StableVector(const StableVector&) = delete;
+    StableVector& operator=(const StableVector&) = delete;
+
+    void reserve(size_t n) {
+        while (allocated << kChunkShift < n) addChunk();
+    }
+
+    ~StableVector() {
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i) (*this)[i].~T();
+        for (size_t i = 0; i < allocated; ++i) ::operator delete(chunks[i].load(memory_order_relaxed));
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        size_t n = count.load(memory_order_relaxed);
+        if ((n >> kChunkShift) == allocated) addChunk();
+        T* slot = chunks[n >> kChunkShift].load(memory_order_relaxed) + (n & (kChunkSize - 1));
+        new (slot) T(std::forward<Args>(args)...);
+        count.store(n + 1, memory_order_release);
+        return *slot;
+    }
+
+    T& operator[](size_t i) { return chunks[i >> kChunkShift].load(memory_order_acquire)[i & (kChunkSize - 1)]; }
+    const T& operator[](size_t i) const {
+        return chunks[i >> kChunkShift].load(memory_order_acquire)[i & (kChunkSize - 1)];
+    }
+
+    size_t size() const { return count.load(memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+};
+
+// Seats left per hall, meal type and date. Reservations reach at most a week ahead, so each hall keeps a ring of
+// kDays dates; a cell packs the day it counts for with the seats left. A cell still holding an older day reads as
+// an empty hall and is reset by the first reservation for its new date, which is how seats come back.
+class CapacityLedger {
+    static constexpr size_t kDays = 8;
+    static constexpr size_t kMealTypes = 3;
+
+    struct HallSeats {
+        int capacity;
+        atomic<uint64_t> cells[kDays * kMealTypes];
+
+        explicit HallSeats(int c) : capacity(c) {
+            for (auto& cell : cells) cell.store(0, memory_order_relaxed);
+        }
+    };
+
+    StableVector<HallSeats> halls;
+
+    static uint64_t pack(uint32_t day, int seats) { return static_cast<uint64_t>(day) << 32 | static_cast<uint32_t>(seats); }
+
+    atomic<uint64_t>& cell(size_t hall, DateTime date, MealType type) {
+        return halls[hall].cells[date.getDay() % kDays * kMealTypes + static_cast<size_t>(type)];
+    }
+
+public:
+    size_t addHall(int capacity) {
+        halls.emplace_back(capacity);
+        return halls.size() - 1;
+    }
+
+    bool tryReserve(size_t hall, DateTime date, MealType type) {
+        atomic<uint64_t>& seats = cell(hall, date, type);
+        uint32_t day = date.getDay();
+        uint64_t current = seats.load(memory_order_relaxed);
+        for (;;) {
+            uint32_t cellDay = static_cast<uint32_t>(current >> 32);
+            if (cellDay > day) return false;
+            int left = cellDay == day ? static_cast<int>(static_cast<uint32_t>(current)) : halls[hall].capacity;
+            if (left <= 0) return false;
+            if (seats.compare_exchange_weak(current, pack(day, left - 1), memory_order_acq_rel, memory_order_relaxed))
+                return true;
+        }
+    }
+
+    // A seat for a date the cell has already moved past has nowhere to go back to.
+    void release(size_t hall, DateTime date, MealType type) {
+        atomic<uint64_t>& seats = cell(hall, date, type);
+        uint64_t current = seats.load(memory_order_relaxed);
+        while (current >> 32 == date.getDay() &&
+               !seats.compare_exchange_weak(current, current + 1, memory_order_acq_rel, memory_order_relaxed)) {}
+    }
+
+    int remaining(size_t hall, DateTime date, MealType type) {
+        uint64_t current = cell(hall, date, type).load(memory_order_acquire);
+        uint32_t cellDay = static_cast<uint32_t>(current >> 32);
+        if (cellDay < date.getDay()) return halls[hall].capacity;
+        return cellDay == date.getDay() ? static_cast<int>(static_cast<uint32_t>(current)) : 0;
+    }
+};
+
+class Storage {
+    atomic<int> mealIdCounter;
+    atomic<int> diningHallIdCounter;
+    atomic<uint64_t> mealRevision;
+    StableVector<Meal> allMeals;
+    StableVector<DiningHall> allDiningHalls;
+    StableVector<Reservation> allReservations;
+    ReservationTable reservationTable;
+    TransactionTable transactionTable;
+    mutex reservationLock;
+    mutex transactionLock;
+    shared_mutex commitGate;
+    StableVector<Student> allStudents;
+    StableVector<Admin> allStaff;
+    IdIndex mealIndex;
+    IdIndex diningHallIndex;
+    IdIndex studentIndex;
+    IdIndex staffIndex;
+    ReservationIndex reservationIndex;
+    CapacityLedger seatLedger;
+    array<mutex, 64> studentLocks;
+
+    Storage() : mealIdCounter(1), diningHallIdCounter(1), mealRevision(0) {}
+    Storage(const Storage&) = delete;
+    void operator=(const Storage&) = delete;
+
+public:
+    static Storage& instance() {
+        static Storage storageInstance;
+        return storageInstance;
+    }
+
+    int generateMealId() { return mealIdCounter.fetch_add(1, memory_order_relaxed); }
+    int generateDiningHallId() { return diningHallIdCounter.fetch_add(1, memory_order_relaxed); }
+    // Ids restored from a snapshot or the log move the generators past them.
+    static void observeId(atomic<int>& counter, int id) {
+        int next = counter.load(memory_order_relaxed);
+        while (next <= id && !counter.compare_exchange_weak(next, id + 1, memory_order_relaxed)) {}
+    }
+
+    // Each element is in place before its id becomes findable.
+    Meal& addMeal(Meal meal) {
+        Meal& stored = allMeals.emplace_back(move(meal));
+        mealIndex.insert(stored.getMealId(), allMeals.size() - 1);
+        observeId(mealIdCounter, stored.getMealId());
+        mealRevision.fetch_add(1, memory_order_release);
+        return stored;
+    }
+    void reserveMeals(size_t extra) {
+        mealIndex.reserve(mealIndex.size() + extra);
+        allMeals.reserve(allMeals.size() + extra);
+    }
+    // Moves a whole batch in; the menu revision moves once for it. Neither add publishes to MenuCatalog.
+    void addMeals(vector<Meal>& batch) {
+        allMeals.reserve(allMeals.size() + batch.size());
+        for (auto& meal : batch) {
+            Meal& stored = allMeals.emplace_back(move(meal));
+            mealIndex.insert(stored.getMealId(), allMeals.size() - 1);
+            observeId(mealIdCounter, stored.getMealId());
+        }
+        mealRevision.fetch_add(1, memory_order_release);
+    }
+    void addDiningHalls(vector<DiningHall>& batch) {
+        for (auto& hall : batch) addDiningHall(move(hall));
+    }
+    // Bumped by every added meal so menu snapshots know when they are stale.
+    uint64_t getMealRevision() const { return mealRevision.load(memory_order_acquire); }
+    DiningHall& addDiningHall(DiningHall hall) {
+        seatLedger.addHall(hall.getCapacity());
+        DiningHall& stored = allDiningHalls.emplace_back(move(hall));
+        diningHallIndex.insert(stored.getHallId(), allDiningHalls.size() - 1);
+        observeId(diningHallIdCounter, stored.getHallId());
+        return stored;
+    }
+
+    Reservation& addReservation(const Reservation& reservation, int studentId) {
+        lock_guard<mutex> guard(reservationLock);
+        Reservation& stored = allReservations.emplace_back(reservation);
+        stored.attach(&reservationTable, reservationTable.append(stored, studentId));
+        reservationIndex.insert(&stored, studentId);
+        return stored;
+    }
+
+    template <typename F>
+    void addReservations(const vector<Reservation>& items, int studentId, F&& added) {
+        lock_guard<mutex> guard(reservationLock);
+        allReservations.reserve(allReservations.size() + items.size());
+        for (const auto& res : items) {
+            Reservation& stored = allReservations.emplace_back(res);
+            added(stored);
+            stored.attach(&reservationTable, reservationTable.append(stored, studentId));
+            reservationIndex.insert(&stored, studentId);
+        }
+    }
+
+    const ReservationTable& getReservationTable() const { return reservationTable; }
+    bool findReservation(uint64_t id, ReservationIndex::Entry& out) const { return reservationIndex.find(id, out); }
+
+    void addTransaction(Student& student, Transaction t) {
+        lock_guard<mutex> guard(transactionLock);
+        transactionTable.append(t, student.getUserId());
+        student.addTransaction(move(t));
+    }
+
+    // Per-student histories are only appended under these locks, so growing them must take both too.
+    void reserveHistory(Student& student, size_t extraReservations, size_t extraTransactions) {
+        scoped_lock guard(reservationLock, transactionLock);
+        student.reserveHistory(extraReservations, extraTransactions);
+    }
+
+    const TransactionTable& getTransactionTable() const { return transactionTable; }
+    StableVector<Reservation>& getReservations() { return allReservations; }
+
+    bool reserveSeat(int hallId, DateTime date, MealType type) {
+        size_t slot = diningHallIndex.find(hallId);
+        return slot != IdIndex::npos && seatLedger.tryReserve(slot, date, type);
+    }
+    void releaseSeat(int hallId, DateTime date, MealType type) {
+        size_t slot = diningHallIndex.find(hallId);
+        if (slot != IdIndex::npos) seatLedger.release(slot, date, type);
+    }
+    int seatsLeft(int hallId, DateTime date, MealType type) {
+        size_t slot = diningHallIndex.find(hallId);
+        return slot == IdIndex::npos ? 0 : seatLedger.remaining(slot, date, type);
+    }
+
+    Student& addStudent(Student student) {
+        Student& stored = allStudents.emplace_back(move(student));
+        studentIndex.insert(stored.getUserId(), allStudents.size() - 1);
+        return stored;
+    }
+    void addStudents(vector<Student>& batch) {
+        for (auto& student : batch) addStudent(move(student));
+    }
+    Student* findStudent(int userId) {
+        size_t slot = studentIndex.find(userId);
+        return slot == IdIndex::npos ? nullptr : &allStudents[slot];
+    }
+    StableVector<Student>& getStudents() { return allStudents; }
+
+    // Hall staff accounts come from the staff file at every start; they are neither snapshotted nor logged.
+    Admin& addStaff(Admin admin) {
+        Admin& stored = allStaff.emplace_back(move(admin));
+        staffIndex.insert(stored.getUserId(), allStaff.size() - 1);
+        return stored;
+    }
+    void addStaff(vector<Admin>& batch) {
+        for (auto& admin : batch) addStaff(move(admin));
+    }
+    Admin* findStaff(int userId) {
+        size_t slot = staffIndex.find(userId);
+        return slot == IdIndex::npos ? nullptr : &allStaff[slot];
+    }
+    StableVector<Admin>& getStaff() { return allStaff; }
+
+    // Held shared by every logged mutation and exclusively while a snapshot forks, so a snapshot
+    // never sees half of a checkout.
+    shared_mutex& getCommitGate() { return commitGate; }
+    // Striped per-student lock for front ends that let one student act from several sessions at once.
+    mutex& getStudentLock(int userId) { return studentLocks[static_cast<unsigned>(userId) % studentLocks.size()]; }
+
+    Meal* findMeal(int id) {
+        size_t slot = mealIndex.find(id);
+        return slot == IdIndex::npos ? nullptr : &allMeals[slot];
+    }
+    DiningHall* findDiningHall(int id) {
+        size_t slot = diningHallIndex.find(id);
+        return slot == IdIndex::npos ? nullptr : &allDiningHalls[slot];
+    }
+
+    StableVector<Meal>& getMeals() { return allMeals; }
+    StableVector<DiningHall>& getDiningHalls() { return allDiningHalls; }
+};
+
+// Read-mostly view of the menu. Readers pin the current immutable version without locks or writes to shared
+// lines; price and availability changes copy the version and publish it, and old versions are freed once no
+// reader that could still see them remains (epoch-based reclamation).
+class MenuCatalog {
+public:
+    struct Item {
+        Meal* meal;
+        int mealId;
+        Money price;
+        bool active;
+        MealType mealType;
+        ReserveDay reserveDay;
+    };
+
+    class Menu {
+        friend class MenuCatalog;
+        static constexpr size_t kSlots = 5 * 3;
+
+        uint64_t revision;
+        vector<Item> items;
+        array<uint32_t, kSlots + 1> slotBegin;
+        vector<pair<int, uint32_t>> byId;
+
+        static size_t slotOf(ReserveDay day, MealType type) {
+            return static_cast<size_t>(day) * 3 + static_cast<size_t>(type);
+        }
+
+    public:
+        uint64_t getRevision() const { return revision; }
+        size_t size() const { return items.size(); }
+
+        const Item* find(int mealId) const {
+            auto it = lower_bound(byId.begin(), byId.end(), pair<int, uint32_t>(mealId, 0));
+            return it != byId.end() && it->first == mealId ? &items[it->second] : nullptr;
+        }
+
+        // Every meal served in one slot, ordered by meal id.
+        pair<const Item*, const Item*> slot(ReserveDay day, MealType type) const {
+            size_t s = slotOf(day, type);
+            return {items.data() + slotBegin[s], items.data() + slotBegin[s + 1]};
+        }
+    };
+
+private:
+    static constexpr size_t kReaderSlots = 256;
+
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{0};
+        atomic<bool> owned{false};
+    };
+
+    struct Retired {
+        const Menu* menu;
+        uint64_t epoch;
+    };
+
+    atomic<const Menu*> current;
+    atomic<uint64_t> globalEpoch;
+    array<ReaderSlot, kReaderSlots> readers;
+    // Readers on threads that found every slot taken; while any is inside, nothing retired is freed.
+    atomic<size_t> overflowReaders;
+    mutex writeLock;
+    vector<Retired> retired;
+
+    MenuCatalog() : current(new Menu()), globalEpoch(1), overflowReaders(0) {}
+    MenuCatalog(const MenuCatalog&) = delete;
+    void operator=(const MenuCatalog&) = delete;
+
+    ~MenuCatalog() {
+        delete current.load(memory_order_relaxed);
+        for (auto& r : retired) delete r.menu;
+    }
+
+    // Each thread owns one slot for its lifetime once it gets one. A thread that finds them all taken
+    // reads through overflowReaders instead and tries again on its next outermost entry.
+    struct ThreadSlot {
+        ReaderSlot* slot = nullptr;
+        size_t depth = 0;
+        ~ThreadSlot() {
+            if (slot) slot->owned.store(false, memory_order_release);
+        }
+    };
+
+    ReaderSlot* slotForThread(ThreadSlot& ts) {
+        for (auto& r : readers) {
+            if (ts.slot) break;
+            bool expected = false;
+            if (!r.owned.load(memory_order_relaxed) && r.owned.compare_exchange_strong(expected, true)) ts.slot = &r;
+        }
+        return ts.slot;
+    }
+
+    static ThreadSlot& threadSlot() {
+        thread_local ThreadSlot ts;
+        return ts;
+    }
+
+    const Menu* enter() {
+        ThreadSlot& ts = threadSlot();
+        if (ts.depth++ == 0) {
+            ReaderSlot* r = slotForThread(ts);
+            if (r) r->epoch.store(globalEpoch.load(memory_order_seq_cst), memory_order_seq_cst);
+            else overflowReaders.fetch_add(1, memory_order_seq_cst);
+        }
+        return current.load(memory_order_seq_cst);
+    }
+    void leave() {
+        ThreadSlot& ts = threadSlot();
+        if (--ts.depth) return;
+        if (ts.slot) ts.slot->epoch.store(0, memory_order_release);
+        else overflowReaders.fetch_sub(1, memory_order_release);
+    }
+
+    static Menu* build(Storage& storage) {
+        Menu* menu = new Menu();
+        menu->revision = storage.getMealRevision();
+        StableVector<Meal>& meals = storage.getMeals();
+        // Meals may be added meanwhile; they bump the revision, so the next refresh picks them up.
+        size_t n = meals.size();
+        array<uint32_t, Menu::kSlots + 1> counts{};
+        for (size_t i = 0; i < n; ++i) ++counts[Menu::slotOf(meals[i].getReserveDay(), meals[i].getMealType()) + 1];
+        for (size_t s = 0; s < Menu::kSlots; ++s) counts[s + 1] += counts[s];
+        menu->slotBegin = counts;
+        menu->items.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            Meal& m = meals[i];
+            menu->items[counts[Menu::slotOf(m.getReserveDay(), m.getMealType())]++] =
+                {&m, m.getMealId(), m.getPrice(), m.getIsActive(), m.getMealType(), m.getReserveDay()};
+        }
+        for (size_t s = 0; s < Menu::kSlots; ++s)
+            sort(menu->items.begin() + menu->slotBegin[s], menu->items.begin() + menu->slotBegin[s + 1],
+                 [](const Item& a, const Item& b) { return a.mealId < b.mealId; });
+        indexIds(*menu);
+        return menu;
+    }
+
+    static void indexIds(Menu& menu) {
+        menu.byId.resize(menu.items.size());
+        for (uint32_t i = 0; i < menu.items.size(); ++i) menu.byId[i] = {menu.items[i].mealId, i};
+        sort(menu.byId.begin(), menu.byId.end());
+    }
+
+    void publishLocked(const Menu* next) {
+        const Menu* old = current.exchange(next, memory_order_seq_cst);
+        uint64_t epoch = globalEpoch.fetch_add(1, memory_order_seq_cst) + 1;
+        if (old) retired.push_back({old, epoch});
+        if (overflowReaders.load(memory_order_seq_cst)) return;
+        uint64_t oldest = epoch;
+        for (auto& r : readers) {
+            uint64_t e = r.epoch.load(memory_order_seq_cst);
+            if (e && e < oldest) oldest = e;
+        }
+        size_t kept = 0;
+        for (auto& r : retired) {
+            if (r.epoch <= oldest) delete r.menu;
+            else retired[kept++] = r;
+        }
+        retired.resize(kept);
+    }
+
+public:
+    // Copies the current version with one meal changed; false if the meal does not exist. change runs under the
+    // write lock, so whatever it records is ordered like the versions themselves.
+    template <typename F>
+    bool update(int mealId, F&& change) {
+        Storage& storage = Storage::instance();
+        lock_guard<mutex> guard(writeLock);
+        Meal* meal = storage.findMeal(mealId);
+        if (!meal) return false;
+        change(*meal);
+        const Menu* base = current.load(memory_order_relaxed);
+        if (!base || base->revision != storage.getMealRevision()) {
+            publishLocked(build(storage));
+            return true;
+        }
+        Menu* next = new Menu(*base);
+        Item& item = next->items[static_cast<size_t>(base->find(mealId) - base->items.data())];
+        item.price = meal->getPrice();
+        item.active = meal->getIsActive();
+        publishLocked(next);
+        return true;
+    }
+
+    static MenuCatalog& instance() {
+        static MenuCatalog catalogInstance;
+        return catalogInstance;
+    }
+
+    // Pins the current menu for the reader's scope. Meals added to Storage show up once their writer refreshes.
+    class Reader {
+        const Menu* menu;
+
+    public:
+        Reader() : menu(MenuCatalog::instance().enter()) {}
+        ~Reader() { MenuCatalog::instance().leave(); }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const Menu* operator->() const { return menu; }
+        const Menu& operator*() const { return *menu; }
+    };
+
+    // Publishes a version with every meal in Storage. Whoever adds meals calls it once when done.
+    void refresh() {
+        Storage& storage = Storage::instance();
+        lock_guard<mutex> guard(writeLock);
+        const Menu* base = current.load(memory_order_relaxed);
+        if (!base || base->revision != storage.getMealRevision()) publishLocked(build(storage));
+    }
+
+    // For changes made straight to Storage's meals, as recovery does; they do not move the revision.
+    void rebuild() {
+        lock_guard<mutex> guard(writeLock);
+        publishLocked(build(Storage::instance()));
+    }
+
+    bool updatePrice(int mealId, Money price) {
+        return update(mealId, [&](Meal& m) { m.updatePrice(price); });
+    }
+    bool deactivate(int mealId) {
+        return update(mealId, [](Meal& m) { m.deactivate(); });
+    }
+    bool activate(int mealId) {
+        return update(mealId, [](Meal& m) { m.activate(); });
+    }
+};
+
+
+// Students turned away by a full hall queue per (hall, date, meal type). A cancellation hands its seat to the queue
+// instead of the open pool while anyone is waiting, and promotePending() later seats and charges the best waiter.
+class WaitlistEngine {
+public:
+    struct Waiter {
+        int studentId;
+        int priority;
+        uint64_t sequence;
+        Meal* meal;
+        DiningHall* hall;
+        DateTime date;
+    };
+
+private:
+    static constexpr size_t kShards = 64;
+
+    // Higher priority first, then first come first served.
+    struct Later {
+        bool operator()(const Waiter& a, const Waiter& b) const {
+            return a.priority != b.priority ? a.priority < b.priority : a.sequence > b.sequence;
+        }
+    };
+
+    // members maps each waiting student to the sequence of their live heap entry. Withdrawn and superseded
+    // entries stay in the heap until they surface at the top or the heap is compacted.
+    struct Queue {
+        vector<Waiter> heap;
+        unordered_map<int, uint64_t> members;
+        size_t claimedSeats = 0;
+    };
+
+    enum class SeatResult { SEATED, SKIPPED, NOT_DURABLE };
+
+    struct alignas(64) Shard {
+        mutex lock;
+        unordered_map<uint64_t, Queue> queues;
+    };
+
+    array<Shard, kShards> shards;
+    atomic<uint64_t> nextSequence;
+    mutex readyLock;
+    vector<uint64_t> ready;
+    atomic<size_t> readyCount;
+
+    WaitlistEngine() : nextSequence(0), readyCount(0) {}
+    WaitlistEngine(const WaitlistEngine&) = delete;
+    void operator=(const WaitlistEngine&) = delete;
+
+    static uint64_t key(int hallId, DateTime date, MealType type) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(hallId)) << 24 | static_cast<uint64_t>(date.getDay()) << 2 |
+               static_cast<uint64_t>(type);
+    }
+    Shard& shardFor(uint64_t k) { return shards[(k ^ (k >> 8)) % kShards]; }
+
+    // A seat held for the queue only counts while somebody is left to take it.
+    bool claimLocked(Queue& q, uint64_t k) {
+        if (q.members.size() <= q.claimedSeats) return false;
+        ++q.claimedSeats;
+        lock_guard<mutex> guard(readyLock);
+        ready.push_back(k);
+        readyCount.fetch_add(1, memory_order_release);
+        return true;
+    }
+
+    static bool live(const Queue& q, const Waiter& w) {
+        auto it = q.members.find(w.studentId);
+        return it != q.members.end() && it->second == w.sequence;
+    }
+
+    static void pushLocked(Queue& q, const Waiter& w) {
+        q.members[w.studentId] = w.sequence;
+        q.heap.push_back(w);
+        push_heap(q.heap.begin(), q.heap.end(), Later());
+        if (q.heap.size() > 2 * q.members.size() + 16) {
+            q.heap.erase(remove_if(q.heap.begin(), q.heap.end(), [&](const Waiter& x) { return !live(q, x); }),
+                         q.heap.end());
+            make_heap(q.heap.begin(), q.heap.end(), Later());
+        }
+    }
+
+    static bool popLocked(Queue& q, Waiter& out) {
+        while (!q.heap.empty()) {
+            pop_heap(q.heap.begin(), q.heap.end(), Later());
+            out = q.heap.back();
+            q.heap.pop_back();
+            if (live(q, out)) {
+                q.members.erase(out.studentId);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    SeatResult seat(const Waiter& w);
+    void promote(uint64_t k);
+
+public:
+    static WaitlistEngine& instance() {
+        static WaitlistEngine waitlistInstance;
+        return waitlistInstance;
+    }
+
+    // Waiters queue for the meal's next occurrence. Returns the queue length after joining, or 0 if the student is
+    // already waiting there. A seat freed in the meantime is claimed straight away.
+    size_t join(int studentId, Meal* meal, DiningHall* hall, int priority = 0) {
+        DateTime date = DateTime::nextOccurrence(meal->getReserveDay(), DateTime::now());
+        MealType type = meal->getMealType();
+        uint64_t k = key(hall->getHallId(), date, type);
+        Shard& s = shardFor(k);
+        size_t length;
+        {
+            lock_guard<mutex> guard(s.lock);
+            Queue& q = s.queues[k];
+            if (q.members.count(studentId)) return 0;
+            pushLocked(q, {studentId, priority, nextSequence.fetch_add(1, memory_order_relaxed), meal, hall, date});
+            length = q.members.size();
+        }
+        if (Storage::instance().reserveSeat(hall->getHallId(), date, type) && !claimSeat(hall->getHallId(), date, type))
+            Storage::instance().releaseSeat(hall->getHallId(), date, type);
+        return length;
+    }
+
+    // False if the student was not waiting. A seat already claimed for the queue stays claimed; promote() passes it
+    // on or gives it back.
+    bool withdraw(int studentId, Meal* meal, DiningHall* hall) {
+        uint64_t k = key(hall->getHallId(), DateTime::nextOccurrence(meal->getReserveDay(), DateTime::now()),
+                         meal->getMealType());
+        Shard& s = shardFor(k);
+        lock_guard<mutex> guard(s.lock);
+        auto it = s.queues.find(k);
+        if (it == s.queues.end()) return false;
+        Queue& q = it->second;
+        if (!q.members.erase(studentId)) return false;
+        if (q.members.empty() && !q.claimedSeats) s.queues.erase(it);
+        return true;
+    }
+
+    // Called with a seat that was just given up. True means the queue took it and it must not go back to the pool.
+    bool claimSeat(int hallId, DateTime date, MealType type) {
+        uint64_t k = key(hallId, date, type);
+        Shard& s = shardFor(k);
+        lock_guard<mutex> guard(s.lock);
+        auto it = s.queues.find(k);
+        return it != s.queues.end() && claimLocked(it->second, k);
+    }
+
+    size_t waiting(int hallId, DateTime date, MealType type) {
+        uint64_t k = key(hallId, date, type);
+        Shard& s = shardFor(k);
+        lock_guard<mutex> guard(s.lock);
+        auto it = s.queues.find(k);
+        return it == s.queues.end() ? 0 : it->second.members.size();
+    }
+
+    // Seats every claimed seat. Takes student locks, so callers must not hold one.
+    void promotePending() {
+        while (readyCount.load(memory_order_acquire)) {
+            uint64_t k;
+            {
+                lock_guard<mutex> guard(readyLock);
+                if (ready.empty()) return;
+                k = ready.back();
+                ready.pop_back();
+                readyCount.fetch_sub(1, memory_order_relaxed);
+            }
+            promote(k);
+        }
+    }
+};
+
+void Student::addReservation(Reservation* reservation) {
+    reservations.push_back(reservation);
+    slideMealWindow(reservation->getCreatedAt().getDay());
+    uint64_t bit;
+    if (Reservation::holdsSeat(reservation->getStatus()) &&
+        mealBit(reservation->getDate(), reservation->getMeal()->getMealType(), bit))
+        activeMeals |= bit;
+}
+
+bool Student::revokeReservation(Reservation* reservation) {
+    if (!reservation->transition(RStatus::SUCCESS, RStatus::CANCELLED)) return false;
+    uint64_t bit;
+    if (mealBit(reservation->getDate(), reservation->getMeal()->getMealType(), bit)) activeMeals &= ~bit;
+    return true;
+}
+
+bool Student::cancelReservation(Reservation* reservation) {
+    if (!revokeReservation(reservation)) return false;
+    Meal* meal = reservation->getMeal();
+    int hallId = reservation->getDiningHall()->getHallId();
+    if (!WaitlistEngine::instance().claimSeat(hallId, reservation->getDate(), meal->getMealType()))
+        Storage::instance().releaseSeat(hallId, reservation->getDate(), meal->getMealType());
+    return true;
+}
+
+namespace Analytics {
+
+    struct ReservationFilter {
+        int hallId = -1;
+        int day = -1;
+        int mealType = -1;
+        int status = -1;
+    };
+
+    struct TransactionFilter {
+        int type = -1;
+        int status = -1;
+    };
+
+    struct Aggregate {
+        size_t count = 0;
+        int64_t sum = 0;
+    };
+
+    enum class ReservationKey { HALL, DAY, MEAL_TYPE, STATUS };
+    enum class TransactionKey { TYPE, STATUS };
+
+    struct HeadcountGrid {
+        Aggregate cells[5][3];
+    };
+
+    using ReservationChunk = ReservationTable::Chunk;
+    using TransactionChunk = TransactionTable::Chunk;
+
+    // Selection bitmaps carry one bit per row, eight rows per byte.
+    constexpr size_t kSelectionBytes = ReservationTable::kChunkRows / 8;
+    static_assert(TransactionTable::kChunkRows / 8 == kSelectionBytes, "tables share chunk geometry");
+
+    inline atomic<bool>& simdEnabled() {
+        static atomic<bool> enabled(true);
+        return enabled;
+    }
+    inline void setSimdEnabled(bool enabled) { simdEnabled().store(enabled, memory_order_relaxed); }
+
+    inline void selectScalar(const ReservationChunk& c, size_t begin, size_t n, const ReservationFilter& f, uint8_t* sel) {
+        for (size_t i = begin; i < n; ++i) {
+            bool hit = (f.hallId < 0 || c.hallIds[i] == f.hallId) && (f.day < 0 || c.days[i] == f.day) &&
+                       (f.mealType < 0 || c.mealTypes[i] == f.mealType) && (f.status < 0 || c.statuses[i] == f.status);
+            if (hit) sel[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+        }
+    }
+
+    inline void selectScalar(const TransactionChunk& c, size_t begin, size_t n, const TransactionFilter& f, uint8_t* sel) {
+        for (size_t i = begin; i < n; ++i) {
+            bool hit = (f.type < 0 || c.types[i] == f.type) && (f.status < 0 || c.statuses[i] == f.status);
+            if (hit) sel[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+        }
+    }
+
+    inline int64_t sumScalar(const int64_t* values, size_t n, const uint8_t* sel) {
+        int64_t total = 0;
+        for (size_t i = 0; i < n; ++i)
+            total += values[i] & -static_cast<int64_t>(sel[i >> 3] >> (i & 7) & 1);
+        return total;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    inline bool hasAvx2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    __attribute__((target("avx2"))) inline __m256i matchBytes(const uint8_t* column, int wanted) {
+        if (wanted < 0) return _mm256_set1_epi32(-1);
+        __m256i widened = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(column)));
+        return _mm256_cmpeq_epi32(widened, _mm256_set1_epi32(wanted));
+    }
+
+    __attribute__((target("avx2"))) inline size_t selectAvx2(const ReservationChunk& c, size_t n, const ReservationFilter& f, uint8_t* sel) {
+        size_t blocks = n / 8;
+        __m256i hall = _mm256_set1_epi32(f.hallId);
+        for (size_t b = 0; b < blocks; ++b) {
+            size_t i = b * 8;
+            __m256i m = f.hallId < 0 ? _mm256_set1_epi32(-1)
+                : _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.hallIds + i)), hall);
+            m = _mm256_and_si256(m, matchBytes(c.days + i, f.day));
+            m = _mm256_and_si256(m, matchBytes(c.mealTypes + i, f.mealType));
+            m = _mm256_and_si256(m, matchBytes(c.statuses + i, f.status));
+            sel[b] = static_cast<uint8_t>(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        }
+        return blocks * 8;
+    }
+
+    __attribute__((target("avx2"))) inline size_t selectAvx2(const TransactionChunk& c, size_t n, const TransactionFilter& f, uint8_t* sel) {
+        size_t blocks = n / 8;
+        for (size_t b = 0; b < blocks; ++b) {
+            size_t i = b * 8;
+            __m256i m = _mm256_and_si256(matchBytes(c.types + i, f.type), matchBytes(c.statuses + i, f.status));
+            sel[b] = static_cast<uint8_t>(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        }
+        return blocks * 8;
+    }
+
+    __attribute__((target("avx2"))) inline int64_t sumAvx2(const int64_t* values, size_t n, const uint8_t* sel) {
+        const __m256i lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+        __m256i acc = _mm256_setzero_si256();
+        size_t blocks = n / 8;
+        for (size_t b = 0; b < blocks; ++b) {
+            __m256i low = _mm256_and_si256(_mm256_set1_epi64x(sel[b] & 15), lanes);
+            __m256i high = _mm256_and_si256(_mm256_set1_epi64x(sel[b] >> 4), lanes);
+            const __m256i* v = reinterpret_cast<const __m256i*>(values + b * 8);
+            acc = _mm256_add_epi64(acc, _mm256_and_si256(_mm256_loadu_si256(v), _mm256_cmpeq_epi64(low, lanes)));
+            acc = _mm256_add_epi64(acc, _mm256_and_si256(_mm256_loadu_si256(v + 1), _mm256_cmpeq_epi64(high, lanes)));
+        }
+        alignas(32) int64_t parts[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(parts), acc);
+        int64_t total = parts[0] + parts[1] + parts[2] + parts[3];
+        return total + sumScalar(values + blocks * 8, n - blocks * 8, sel + blocks);
+    }
+#endif
+
+    template <typename Chunk, typename Filter>
+    void select(const Chunk& c, size_t n, const Filter& f, uint8_t* sel) {
+        memset(sel, 0, (n + 7) / 8);
+        size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        if (simdEnabled().load(memory_order_relaxed) && hasAvx2()) done = selectAvx2(c, n, f, sel);
+#endif
+        selectScalar(c, done, n, f, sel);
+    }
+
+    inline Aggregate accumulate(const int64_t* values, size_t n, const uint8_t* sel) {
+        Aggregate a;
+        for (size_t b = 0; b < (n + 7) / 8; ++b) a.count += static_cast<size_t>(__builtin_popcount(sel[b]));
+#if defined(__x86_64__) || defined(__i386__)
+        if (simdEnabled().load(memory_order_relaxed) && hasAvx2()) {
+            a.sum = sumAvx2(values, n, sel);
+            return a;
+        }
+#endif
+        a.sum = sumScalar(values, n, sel);
+        return a;
+    }
+
+    template <typename F>
+    void forEachSelected(const uint8_t* sel, size_t n, F&& f) {
+        for (size_t b = 0; b < (n + 7) / 8; ++b)
+            for (unsigned bits = sel[b]; bits; bits &= bits - 1) f(b * 8 + static_cast<size_t>(__builtin_ctz(bits)));
+    }
+
+    // Head count and revenue of reservations matching the filter.
+    inline Aggregate aggregate(const ReservationTable& table, const ReservationFilter& f) {
+        Aggregate total;
+        vector<uint8_t> sel(kSelectionBytes);
+        table.forEachChunk([&](const ReservationChunk& c, size_t n) {
+            select(c, n, f, sel.data());
+            Aggregate part = accumulate(c.prices, n, sel.data());
+            total.count += part.count;
+            total.sum += part.sum;
+        });
+        return total;
+    }
+
+    inline Aggregate aggregate(const TransactionTable& table, const TransactionFilter& f) {
+        Aggregate total;
+        vector<uint8_t> sel(kSelectionBytes);
+        table.forEachChunk([&](const TransactionChunk& c, size_t n) {
+            select(c, n, f, sel.data());
+            Aggregate part = accumulate(c.amounts, n, sel.data());
+            total.count += part.count;
+            total.sum += part.sum;
+        });
+        return total;
+    }
+
+    // Groups matching reservations by one column; results are ordered by key.
+    inline vector<pair<int, Aggregate>> groupBy(const ReservationTable& table, const ReservationFilter& f, ReservationKey key) {
+        IdIndex slots;
+        vector<pair<int, Aggregate>> groups;
+        vector<uint8_t> sel(kSelectionBytes);
+        table.forEachChunk([&](const ReservationChunk& c, size_t n) {
+            select(c, n, f, sel.data());
+            forEachSelected(sel.data(), n, [&](size_t i) {
+                int k = 0;
+                switch (key) {
+                    case ReservationKey::HALL: k = c.hallIds[i]; break;
+                    case ReservationKey::DAY: k = c.days[i]; break;
+                    case ReservationKey::MEAL_TYPE: k = c.mealTypes[i]; break;
+                    case ReservationKey::STATUS: k = c.statuses[i]; break;
+                }
+                size_t slot = slots.find(k);
+                if (slot == IdIndex::npos) {
+                    slot = groups.size();
+                    slots.insert(k, slot);
+                    groups.push_back({k, Aggregate()});
+                }
+                groups[slot].second.count += 1;
+                groups[slot].second.sum += c.prices[i];
+            });
+        });
+        sort(groups.begin(), groups.end(), [](const pair<int, Aggregate>& a, const pair<int, Aggregate>& b) { return a.first < b.first; });
+        return groups;
+    }
+
+    inline vector<pair<int, Aggregate>> groupBy(const TransactionTable& table, const TransactionFilter& f, TransactionKey key) {
+        vector<pair<int, Aggregate>> groups;
+        Aggregate cells[4];
+        vector<uint8_t> sel(kSelectionBytes);
+        table.forEachChunk([&](const TransactionChunk& c, size_t n) {
+            select(c, n, f, sel.data());
+            forEachSelected(sel.data(), n, [&](size_t i) {
+                Aggregate& cell = cells[key == TransactionKey::TYPE ? c.types[i] & 3 : c.statuses[i] & 3];
+                cell.count += 1;
+                cell.sum += c.amounts[i];
+            });
+        });
+        for (int k = 0; k < 4; ++k)
+            if (cells[k].count) groups.push_back({k, cells[k]});
+        return groups;
+    }
+
+    // Kitchen planning: confirmed head counts and revenue per (ReserveDay, MealType) for one hall.
+    inline HeadcountGrid headcounts(const ReservationTable& table, int hallId) {
+        HeadcountGrid grid;
+        ReservationFilter f;
+        f.hallId = hallId;
+        vector<uint8_t> sel(kSelectionBytes);
+        table.forEachChunk([&](const ReservationChunk& c, size_t n) {
+            select(c, n, f, sel.data());
+            forEachSelected(sel.data(), n, [&](size_t i) {
+                if (!Reservation::holdsSeat(static_cast<RStatus>(c.statuses[i]))) return;
+                Aggregate& cell = grid.cells[c.days[i] % 5][c.mealTypes[i] % 3];
+                cell.count += 1;
+                cell.sum += c.prices[i];
+            });
+        });
+        return grid;
+    }
+
+}
+
+class IDGenerator {
+    static constexpr uint64_t kBlockSize = 1024;
+    static constexpr uint64_t kEpochMillis = 1735689600000ull;
+    static constexpr unsigned kWorkerBits = 10;
+    static constexpr unsigned kSequenceBits = 12;
+
+    struct alignas(64) Counter {
+        atomic<uint64_t> next;
+        explicit Counter(uint64_t first) : next(first) {}
+    };
+
+    struct Lease {
+        uint64_t next = 0;
+        uint64_t end = 0;
+    };
+
+    struct Clock {
+        uint64_t worker;
+        uint64_t lastMillis = 0;
+        uint64_t sequence = 0;
+        Clock() : worker(nextWorker.fetch_add(1, memory_order_relaxed) & ((1u << kWorkerBits) - 1)) {}
+    };
+
+    static Counter reservationCounter;
+    static Counter transactionCounter;
+    static atomic<uint64_t> nextWorker;
+    static atomic<bool> timeOrdered;
+
+    static uint64_t lease(Counter& counter, Lease& local) {
+        if (local.next == local.end) {
+            local.next = counter.next.fetch_add(kBlockSize, memory_order_relaxed);
+            local.end = local.next + kBlockSize;
+        }
+        return local.next++;
+    }
+
+    static void observe(Counter& counter, uint64_t id) {
+        uint64_t next = counter.next.load(memory_order_relaxed);
+        while (next <= id && !counter.next.compare_exchange_weak(next, id + 1, memory_order_relaxed)) {}
+    }
+
+    static uint64_t millis() {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+public:
+    static void setTimeOrdered(bool enabled) { timeOrdered.store(enabled, memory_order_relaxed); }
+
+    static void observeReservationId(uint64_t id) { observe(reservationCounter, id); }
+    static void observeTransactionId(uint64_t id) { observe(transactionCounter, id); }
+
+    // 41 bits of milliseconds since 2025-01-01, 10 bits of worker, 12 bits of per-millisecond sequence.
+    static uint64_t generateTimeOrderedId() {
+        thread_local Clock clock;
+        uint64_t now = millis() - kEpochMillis;
+        if (now <= clock.lastMillis) {
+            now = clock.lastMillis;
+            if (++clock.sequence >> kSequenceBits) {
+                while ((now = millis() - kEpochMillis) <= clock.lastMillis) {}
+                clock.sequence = 0;
+            }
+        } else {
+            clock.sequence = 0;
+        }
+        clock.lastMillis = now;
+        return (now << (kWorkerBits + kSequenceBits)) | (clock.worker << kSequenceBits) | clock.sequence;
+    }
+
+    static uint64_t generateReservationId() {
+        if (timeOrdered.load(memory_order_relaxed)) return generateTimeOrderedId();
+        thread_local Lease local;
+        return lease(reservationCounter, local);
+    }
+
+    static uint64_t generateTransactionId() {
+        if (timeOrdered.load(memory_order_relaxed)) return generateTimeOrderedId();
+        thread_local Lease local;
+        return lease(transactionCounter, local);
+    }
+};
+
+IDGenerator::Counter IDGenerator::reservationCounter(1);
+IDGenerator::Counter IDGenerator::transactionCounter(1000);
+atomic<uint64_t> IDGenerator::nextWorker(0);
+atomic<bool> IDGenerator::timeOrdered(false);
+
+class ShoppingCart {
+    vector<Reservation> reservations;
+
+public:
+    void addReservation(const Reservation& reservation) {
+        reservations.push_back(reservation);
+    }
+
+    void removeReservation(uint64_t id) {
+        for (auto it = reservations.begin(); it != reservations.end(); ++it) {
+            if (it->getReservationId() == id) {
+                reservations.erase(it);
+                break;
+            }
+        }
+    }
+
+    void viewShoppingCartItems() const {
+        cout << "Shopping Cart Items:" << '\n';
+        for (const auto& res : reservations) {
+            res.print();
+            cout << "------------------------" << '\n';
+        }
+    }
+
+    void clear() {
+        reservations.clear();
+    }
+
+    const vector<Reservation>& getReservations() const {
+        return reservations;
     }
 
     Transaction confirm();
 };
 
+enum class WalRecordType : uint8_t {
+    RESERVATION = 1, CANCELLATION = 2, TRANSACTION = 3, CHECK_IN = 4, MEAL = 5, MEAL_STATE = 6, HALL = 7, STUDENT = 8,
+    TEXT = 9
+};
+
+struct WalRecord {
+    uint32_t crc;
+    WalRecordType type;
+    uint8_t status;
+    uint8_t kind;
+    uint8_t reserved;
+    int32_t userId;
+    int32_t mealId;
+    int32_t hallId;
+    uint32_t date;
+    uint32_t createdAt;
+    int64_t amount;
+    uint64_t id;
+
+    static uint32_t crc32c(const uint8_t* data, size_t len) {
+        static const auto table = [] {
+            array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0x82F63B78u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        uint32_t c = ~0u;
+        for (size_t i = 0; i < len; ++i) c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        return ~c;
+    }
+
+    uint32_t checksum() const {
+        return crc32c(reinterpret_cast<const uint8_t*>(this) + sizeof(crc), sizeof(WalRecord) - sizeof(crc));
+    }
+    void seal() { crc = checksum(); }
+    bool valid() const { return crc == checksum(); }
+
+    static WalRecord blank(WalRecordType type, int userId, uint64_t id) {
+        WalRecord r;
+        memset(&r, 0, sizeof(r));
+        r.type = type;
+        r.userId = userId;
+        r.id = id;
+        return r;
+    }
+
+    static WalRecord reservation(int userId, const Reservation& res) {
+        WalRecord r = blank(WalRecordType::RESERVATION, userId, res.getReservationId());
+        r.status = static_cast<uint8_t>(res.getStatus());
+        r.mealId = res.getMeal()->getMealId();
+        r.hallId = res.getDiningHall()->getHallId();
+        r.date = res.getDate().getPacked();
+        r.createdAt = res.getCreatedAt().getPacked();
+        r.seal();
+        return r;
+    }
+
+    static WalRecord cancellation(int userId, uint64_t reservationId) {
+        WalRecord r = blank(WalRecordType::CANCELLATION, userId, reservationId);
+        r.seal();
+        return r;
+    }
+
+    static WalRecord checkIn(int userId, uint64_t reservationId) {
+        WalRecord r = blank(WalRecordType::CHECK_IN, userId, reservationId);
+        r.seal();
+        return r;
+    }
+
+    static WalRecord transaction(int userId, const Transaction& t) {
+        WalRecord r = blank(WalRecordType::TRANSACTION, userId, t.getTransactionID());
+        r.status = static_cast<uint8_t>(t.getStatus());
+        r.kind = static_cast<uint8_t>(t.getType());
+        r.amount = t.getAmount().getCents();
+        r.createdAt = t.getCreatedAt().getPacked();
+        r.seal();
+        return r;
+    }
+
+    // Everything after the type byte and flags; TEXT records fill it with string bytes.
+    static constexpr size_t kTextBytes = 40;
+
+    // A meal's price and whether it is on sale, the part admins change after it is added.
+    static WalRecord mealState(const Meal& meal) {
+        WalRecord r = blank(WalRecordType::MEAL_STATE, 0, 0);
+        r.mealId = meal.getMealId();
+        r.amount = meal.getPrice().getCents();
+        r.reserved = meal.getIsActive();
+        r.seal();
+        return r;
+    }
+
+    static void meal(const Meal& meal, vector<WalRecord>& out) {
+        WalRecord r = mealState(meal);
+        r.type = WalRecordType::MEAL;
+        r.kind = static_cast<uint8_t>(meal.getMealType());
+        r.status = static_cast<uint8_t>(meal.getReserveDay());
+        array<string_view, 1 + Meal::kMaxSideItems> text;
+        text[0] = meal.getName();
+        for (size_t i = 0; i < meal.getSideItemCount(); ++i) text[i + 1] = meal.getSideItem(i);
+        withText(r, text.data(), 1 + meal.getSideItemCount(), out);
+    }
+
+    static void hall(const DiningHall& hall, vector<WalRecord>& out) {
+        WalRecord r = blank(WalRecordType::HALL, 0, 0);
+        r.hallId = hall.getHallId();
+        r.amount = hall.getCapacity();
+        string_view text[] = {hall.getName(), hall.getAddress()};
+        withText(r, text, 2, out);
+    }
+
+    static void student(const Student& student, vector<WalRecord>& out) {
+        WalRecord r = blank(WalRecordType::STUDENT, student.getUserId(), 0);
+        r.amount = student.getAccountBalance().getCents();
+        r.reserved = student.getIsActive();
+        string_view text[] = {student.getStudentId(), student.getName(),  student.getLastName(),
+                              student.getEmail(),     student.getPhone(), student.getHashedPassword()};
+        withText(r, text, 6, out);
+    }
+
+    // Strings ride in TEXT records right behind the record they belong to, each prefixed with its 32-bit length;
+    // the leading record's id holds the total byte count.
+    static void withText(WalRecord head, const string_view* fields, size_t count, vector<WalRecord>& out) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < count; ++i) bytes += sizeof(uint32_t) + fields[i].size();
+        head.id = bytes;
+        head.seal();
+        out.push_back(head);
+        size_t first = out.size();
+        out.resize(first + (bytes + kTextBytes - 1) / kTextBytes, blank(WalRecordType::TEXT, 0, 0));
+        size_t at = 0;
+        auto put = [&](const void* data, size_t len) {
+            const char* p = static_cast<const char*>(data);
+            while (len > 0) {
+                size_t n = min(len, kTextBytes - at % kTextBytes);
+                memcpy(out[first + at / kTextBytes].text() + at % kTextBytes, p, n);
+                at += n;
+                p += n;
+                len -= n;
+            }
+        };
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t len = static_cast<uint32_t>(fields[i].size());
+            put(&len, sizeof(len));
+            put(fields[i].data(), fields[i].size());
+        }
+        for (size_t i = first; i < out.size(); ++i) out[i].seal();
+    }
+
+    char* text() { return reinterpret_cast<char*>(&userId); }
+    const char* text() const { return reinterpret_cast<const char*>(&userId); }
+};
+
+static_assert(sizeof(WalRecord) == 48, "WAL records are written as raw 48-byte blocks");
+static_assert(offsetof(WalRecord, userId) + WalRecord::kTextBytes == sizeof(WalRecord), "TEXT fills the record");
+
+class WriteAheadLog {
+    static constexpr char kMagic[8] = {'R', 'S', 'V', 'W', 'A', 'L', '0', '3'};
+
+    // baseLsn is the sequence number of the first record in the file; older ones were dropped after a snapshot.
+    struct Header {
+        char magic[8];
+        uint64_t baseLsn;
+    };
+
+    int fd;
+    string path;
+    uint64_t baseLsn;
+    mutex lock;
+    condition_variable flushNeeded;
+    condition_variable flushed;
+    vector<WalRecord> pending;
+    vector<WalRecord> writing;
+    uint64_t appendedLsn;
+    uint64_t durableLsn;
+    bool stopping;
+    bool failed;
+    thread flusher;
+
+    WriteAheadLog() : fd(-1), baseLsn(0), appendedLsn(0), durableLsn(0), stopping(false), failed(false) {}
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    void operator=(const WriteAheadLog&) = delete;
+
+    static bool writeAll(int file, const void* data, size_t len) {
+        const char* p = static_cast<const char*>(data);
+        while (len > 0) {
+            ssize_t n = ::write(file, p, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static Header header(uint64_t base) {
+        Header h;
+        memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.baseLsn = base;
+        return h;
+    }
+
+    // Copies records [from, to) of a log whose first record is base.
+    static bool copyRecords(int src, int dst, uint64_t base, uint64_t from, uint64_t to) {
+        WalRecord batch[256];
+        while (from < to) {
+            size_t count = static_cast<size_t>(min<uint64_t>(to - from, 256));
+            size_t bytes = count * sizeof(WalRecord);
+            off_t at = static_cast<off_t>(sizeof(Header) + (from - base) * sizeof(WalRecord));
+            if (pread(src, batch, bytes, at) != static_cast<ssize_t>(bytes) || !writeAll(dst, batch, bytes)) return false;
+            from += count;
+        }
+        return true;
+    }
+
+    void flushLoop() {
+        unique_lock<mutex> guard(lock);
+        for (;;) {
+            flushNeeded.wait(guard, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break;
+            swap(pending, writing);
+            uint64_t target = appendedLsn;
+            guard.unlock();
+            bool ok = writeAll(fd, writing.data(), writing.size() * sizeof(WalRecord)) && fdatasync(fd) == 0;
+            guard.lock();
+            if (!ok) failed = true;
+            durableLsn = target;
+            writing.clear();
+            flushed.notify_all();
+        }
+    }
+
+    static bool carriesText(WalRecordType type) {
+        return type == WalRecordType::MEAL || type == WalRecordType::HALL || type == WalRecordType::STUDENT;
+    }
+
+    static bool splitText(string_view payload, vector<string_view>& fields) {
+        fields.clear();
+        while (!payload.empty()) {
+            uint32_t len;
+            if (payload.size() < sizeof(len)) return false;
+            memcpy(&len, payload.data(), sizeof(len));
+            payload.remove_prefix(sizeof(len));
+            if (payload.size() < len) return false;
+            fields.push_back(payload.substr(0, len));
+            payload.remove_prefix(len);
+        }
+        return true;
+    }
+
+    // False if the record refers to a student, meal, hall or reservation that is not there, or adds one that is.
+    static bool apply(const WalRecord& r, const vector<string_view>& text) {
+        Storage& storage = Storage::instance();
+        switch (r.type) {
+            case WalRecordType::MEAL: {
+                if (storage.findMeal(r.mealId) || text.empty() || text.size() > 1 + Meal::kMaxSideItems) return false;
+                Meal meal;
+                meal.setMealId(r.mealId);
+                meal.setPrice(Money::fromCents(r.amount));
+                meal.setMealType(static_cast<MealType>(r.kind));
+                meal.setReserveDay(static_cast<ReserveDay>(r.status));
+                if (!r.reserved) meal.deactivate();
+                meal.setName(text[0]);
+                for (size_t i = 1; i < text.size(); ++i)
+                    if (!meal.addSideItem(text[i])) return false;
+                storage.addMeal(move(meal));
+                return true;
+            }
+            case WalRecordType::MEAL_STATE: {
+                Meal* meal = storage.findMeal(r.mealId);
+                if (!meal) return false;
+                meal->updatePrice(Money::fromCents(r.amount));
+                if (r.reserved) meal->activate();
+                else meal->deactivate();
+                return true;
+            }
+            case WalRecordType::HALL: {
+                if (storage.findDiningHall(r.hallId) || text.size() != 2) return false;
+                DiningHall hall;
+                hall.setHallId(r.hallId);
+                hall.setCapacity(static_cast<int>(r.amount));
+                hall.setName(string(text[0]));
+                hall.setAddress(string(text[1]));
+                storage.addDiningHall(move(hall));
+                return true;
+            }
+            case WalRecordType::STUDENT: {
+                if (storage.findStudent(r.userId) || text.size() != 6) return false;
+                Student& student = storage.addStudent(Student(r.userId, string(text[0]), string(text[1]),
+                                                              string(text[2]), string(text[3]), string(text[4]),
+                                                              Money::fromCents(r.amount), string(text[5])));
+                if (!r.reserved) student.deactivate();
+                return true;
+            }
+            default:
+                break;
+        }
+        Student* student = storage.findStudent(r.userId);
+        if (!student) return false;
+        switch (r.type) {
+            case WalRecordType::RESERVATION: {
+                Meal* meal = storage.findMeal(r.mealId);
+                DiningHall* hall = storage.findDiningHall(r.hallId);
+                if (!meal || !hall) return false;
+                Reservation res(r.id, hall, meal);
+                res.setStatus(static_cast<RStatus>(r.status));
+                res.setCreatedAt(DateTime::fromPacked(r.createdAt));
+                res.setDate(DateTime::fromPacked(r.date));
+                if (Reservation::holdsSeat(res.getStatus()))
+                    storage.reserveSeat(r.hallId, res.getDate(), meal->getMealType());
+                student->addReservation(&storage.addReservation(res, r.userId));
+                IDGenerator::observeReservationId(r.id);
+                return true;
+            }
+            case WalRecordType::CANCELLATION: {
+                ReservationIndex::Entry e;
+                if (!storage.findReservation(r.id, e) || e.studentId != r.userId) return false;
+                student->cancelReservation(e.reservation);
+                return true;
+            }
+            case WalRecordType::CHECK_IN: {
+                ReservationIndex::Entry e;
+                if (!storage.findReservation(r.id, e)) return false;
+                e.reservation->transition(RStatus::SUCCESS, RStatus::CHECKED_IN);
+                return true;
+            }
+            case WalRecordType::TRANSACTION: {
+                Transaction t;
+                t.setTransactionID(r.id);
+                t.setAmount(Money::fromCents(r.amount));
+                t.setType(static_cast<TransactionType>(r.kind));
+                t.setStatus(static_cast<TransactionStatus>(r.status));
+                t.setCreatedAt(DateTime::fromPacked(r.createdAt));
+                if (t.getStatus() == TransactionStatus::COMPLETED) {
+                    student->credit(t.getType() == TransactionType::PAYMENT ? -t.getAmount() : t.getAmount());
+                }
+                storage.addTransaction(*student, move(t));
+                IDGenerator::observeTransactionId(r.id);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+public:
+    static WriteAheadLog& instance() {
+        static WriteAheadLog walInstance;
+        return walInstance;
+    }
+
+    ~WriteAheadLog() { close(); }
+
+    // Rebuilds the catalog, roster, reservations and balances from the log, skipping the first fromLsn records
+    // (already covered by a snapshot). A torn or corrupt tail is cut off so appends resume cleanly; a record that
+    // lost its TEXT records to the tear goes with them. Returns false, leaving the file alone, if it is not a log,
+    // was trimmed past fromLsn so records in between are gone, or holds a record that does not fit the state
+    // rebuilt so far; Storage then holds everything applied before that record.
+    static bool replay(const string& path, uint64_t fromLsn, size_t& applied) {
+        applied = 0;
+        int file = ::open(path.c_str(), O_RDWR);
+        if (file < 0) return errno == ENOENT;
+        Header h;
+        uint64_t seen = 0;
+        off_t good = 0;
+        auto refuse = [&](const char* why) {
+            cout << path << ": " << why << endl;
+            ::close(file);
+            return false;
+        };
+        ssize_t got = ::read(file, &h, sizeof(h));
+        if (got == sizeof(h) && memcmp(h.magic, kMagic, sizeof(kMagic)) == 0) {
+            good = sizeof(h);
+            seen = h.baseLsn;
+            if (fromLsn < seen) {
+                cout << path << " starts at record " << seen << " but the snapshot only covers " << fromLsn << endl;
+                ::close(file);
+                return false;
+            }
+            WalRecord batch[256];
+            WalRecord head;
+            uint64_t headLsn = 0;
+            size_t textLeft = 0;
+            string payload;
+            vector<string_view> text;
+            bool torn = false;
+            while (!torn) {
+                ssize_t n = ::read(file, batch, sizeof(batch));
+                if (n <= 0) break;
+                size_t count = static_cast<size_t>(n) / sizeof(WalRecord);
+                torn = static_cast<size_t>(n) % sizeof(WalRecord) != 0;
+                for (size_t i = 0; i < count; ++i) {
+                    const WalRecord& r = batch[i];
+                    if (!r.valid()) {
+                        torn = true;
+                        break;
+                    }
+                    uint64_t lsn = seen++;
+                    if (textLeft) {
+                        if (r.type != WalRecordType::TEXT) return refuse("a record is missing its text");
+                        payload.append(r.text(), min<size_t>(WalRecord::kTextBytes, head.id - payload.size()));
+                        if (--textLeft) continue;
+                    } else if (r.type == WalRecordType::TEXT) {
+                        return refuse("text without a record it belongs to");
+                    } else {
+                        head = r;
+                        headLsn = lsn;
+                        payload.clear();
+                        textLeft = carriesText(r.type) ? (r.id + WalRecord::kTextBytes - 1) / WalRecord::kTextBytes : 0;
+                        if (textLeft) continue;
+                    }
+                    good = static_cast<off_t>(sizeof(h) + (seen - h.baseLsn) * sizeof(WalRecord));
+                    if (headLsn < fromLsn) continue;
+                    if (!splitText(payload, text) || !apply(head, text)) {
+                        cout << path << ": record " << headLsn << " does not match what came before it" << endl;
+                        ::close(file);
+                        return false;
+                    }
+                    ++applied;
+                }
+            }
+        } else if (got == sizeof(h)) {
+            return refuse("not a reservation log");
+        }
+        if (ftruncate(file, good) != 0) cout << "Could not cut the torn tail off " << path << endl;
+        ::close(file);
+        return true;
+    }
+
+    bool open(const string& logPath) {
+        lock_guard<mutex> guard(lock);
+        if (fd >= 0) return true;
+        fd = ::open(logPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return false;
+        off_t size = lseek(fd, 0, SEEK_END);
+        Header h = header(0);
+        bool ok = size == 0 ? writeAll(fd, &h, sizeof(h)) && fdatasync(fd) == 0
+                            : pread(fd, &h, sizeof(h), 0) == sizeof(h) && memcmp(h.magic, kMagic, sizeof(kMagic)) == 0;
+        if (!ok) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        path = logPath;
+        baseLsn = h.baseLsn;
+        size = max<off_t>(size, sizeof(h));
+        appendedLsn = baseLsn + static_cast<uint64_t>(size - sizeof(h)) / sizeof(WalRecord);
+        durableLsn = appendedLsn;
+        stopping = false;
+        failed = false;
+        flusher = thread(&WriteAheadLog::flushLoop, this);
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> guard(lock);
+            if (fd < 0) return;
+            stopping = true;
+        }
+        flushNeeded.notify_one();
+        flusher.join();
+        lock_guard<mutex> guard(lock);
+        ::close(fd);
+        fd = -1;
+    }
+
+    bool isOpen() {
+        lock_guard<mutex> guard(lock);
+        return fd >= 0;
+    }
+
+    // Queues records for the next group flush and returns the sequence number of the last one,
+    // or 0 when no log is open.
+    uint64_t append(const WalRecord* records, size_t count) {
+        lock_guard<mutex> guard(lock);
+        if (fd < 0 || count == 0) return 0;
+        pending.insert(pending.end(), records, records + count);
+        appendedLsn += count;
+        flushNeeded.notify_one();
+        return appendedLsn;
+    }
+
+    uint64_t getAppendedLsn() {
+        lock_guard<mutex> guard(lock);
+        return appendedLsn;
+    }
+
+    // False once a write or fsync has failed: the change is applied in memory but may not survive a restart.
+    bool waitDurable(uint64_t lsn) {
+        unique_lock<mutex> guard(lock);
+        flushed.wait(guard, [&] { return durableLsn >= lsn || fd < 0; });
+        return !failed;
+    }
+
+    // Lets a front end answer a run of requests with one durability wait. While a batch is open on this thread,
+    // awaitDurable only notes the lsn and reports success; endBatch waits once for all of them, and no reply that
+    // went through awaitDurable may be sent before it returns. If it returns false those replies must be replaced.
+    struct Batch {
+        bool open = false;
+        bool deferred = false;  // set by awaitDurable; the front end clears it before each request
+        uint64_t lsn = 0;
+    };
+    static Batch& batch() {
+        thread_local Batch b;
+        return b;
+    }
+    void beginBatch() { batch() = Batch{true, false, 0}; }
+    bool endBatch() {
+        Batch& b = batch();
+        b.open = false;
+        return !b.lsn || waitDurable(b.lsn);
+    }
+    bool awaitDurable(uint64_t lsn) {
+        Batch& b = batch();
+        if (!b.open) return waitDurable(lsn);
+        b.lsn = max(b.lsn, lsn);
+        b.deferred = true;
+        return true;
+    }
+
+    // Rewrites the log without the records before lsn, which a snapshot now covers. The bulk is copied while
+    // requests keep committing; only what was appended meanwhile is copied under the exclusive commit gate.
+    // Must not run alongside open or close. Returns false if the log could not be rewritten; it is left as is.
+    bool discardBefore(uint64_t lsn) {
+        uint64_t base;
+        {
+            lock_guard<mutex> guard(lock);
+            if (fd < 0 || lsn <= baseLsn) return true;
+            base = baseLsn;
+        }
+        if (!waitDurable(lsn)) return false;
+        string tmp = path + ".tmp";
+        int src = ::open(path.c_str(), O_RDONLY);
+        int dst = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        Header h = header(lsn);
+        uint64_t copied = lsn;
+        bool ok = src >= 0 && dst >= 0 && writeAll(dst, &h, sizeof(h));
+        if (ok) {
+            uint64_t durable;
+            {
+                lock_guard<mutex> guard(lock);
+                durable = durableLsn;
+            }
+            ok = copyRecords(src, dst, base, copied, durable);
+            copied = durable;
+        }
+        if (ok) {
+            unique_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            uint64_t end = getAppendedLsn();
+            ok = waitDurable(end) && copyRecords(src, dst, base, copied, end) && fdatasync(dst) == 0 &&
+                 rename(tmp.c_str(), path.c_str()) == 0;
+            if (ok) {
+                // The copy is positioned at its end, so the flusher keeps appending to it directly.
+                lock_guard<mutex> guard(lock);
+                ::close(fd);
+                fd = dst;
+                dst = -1;
+                baseLsn = lsn;
+            }
+        }
+        if (src >= 0) ::close(src);
+        if (dst >= 0) {
+            ::close(dst);
+            unlink(tmp.c_str());
+        }
+        return ok;
+    }
+};
+
+constexpr char WriteAheadLog::kMagic[8];
+
+class Snapshot {
+    static constexpr char kMagic[8] = {'R', 'S', 'V', 'S', 'N', 'P', '0', '3'};
+
+    struct Header {
+        char magic[8];
+        uint64_t walLsn;
+        uint64_t bodySize;
+        uint32_t bodyCrc;
+        uint32_t meals;
+        uint32_t halls;
+        uint32_t students;
+    };
+
+    class Writer {
+        vector<char> data;
+
+    public:
+        template <typename T>
+        void put(T value) {
+            const char* p = reinterpret_cast<const char*>(&value);
+            data.insert(data.end(), p, p + sizeof(T));
+        }
+        void put(string_view value) {
+            put(static_cast<uint32_t>(value.size()));
+            data.insert(data.end(), value.begin(), value.end());
+        }
+        void put(const string& value) { put(string_view(value)); }
+        const vector<char>& bytes() const { return data; }
+    };
+
+    class Reader {
+        const char* p;
+        const char* end;
+        bool ok;
+
+    public:
+        Reader(const char* begin, const char* e) : p(begin), end(e), ok(true) {}
+
+        template <typename T>
+        T get() {
+            T value{};
+            if (static_cast<size_t>(end - p) < sizeof(T)) {
+                ok = false;
+                return value;
+            }
+            memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+        // The view points into the mapped snapshot and is only valid while it is mapped.
+        string_view getView() {
+            uint32_t len = get<uint32_t>();
+            if (!ok || static_cast<size_t>(end - p) < len) {
+                ok = false;
+                return string_view();
+            }
+            string_view value(p, len);
+            p += len;
+            return value;
+        }
+        string getString() { return string(getView()); }
+        bool good() const { return ok; }
+    };
+
+    static void encode(Writer& w, Header& h) {
+        Storage& storage = Storage::instance();
+        h.meals = static_cast<uint32_t>(storage.getMeals().size());
+        h.halls = static_cast<uint32_t>(storage.getDiningHalls().size());
+        h.students = static_cast<uint32_t>(storage.getStudents().size());
+
+        for (auto& meal : storage.getMeals()) {
+            w.put(static_cast<int32_t>(meal.getMealId()));
+            w.put(meal.getPrice().getCents());
+            w.put(static_cast<uint8_t>(meal.getIsActive()));
+            w.put(static_cast<uint8_t>(meal.getMealType()));
+            w.put(static_cast<uint8_t>(meal.getReserveDay()));
+            w.put(meal.getName());
+            w.put(static_cast<uint32_t>(meal.getSideItemCount()));
+            for (size_t k = 0; k < meal.getSideItemCount(); ++k) w.put(meal.getSideItem(k));
+        }
+        for (auto& hall : storage.getDiningHalls()) {
+            w.put(static_cast<int32_t>(hall.getHallId()));
+            w.put(static_cast<int32_t>(hall.getCapacity()));
+            w.put(hall.getName());
+            w.put(hall.getAddress());
+        }
+        for (auto& student : storage.getStudents()) {
+            w.put(static_cast<int32_t>(student.getUserId()));
+            w.put(student.getAccountBalance().getCents());
+            w.put(static_cast<uint8_t>(student.getIsActive()));
+            w.put(student.getStudentId());
+            w.put(student.getName());
+            w.put(student.getLastName());
+            w.put(student.getEmail());
+            w.put(student.getPhone());
+            w.put(student.getHashedPassword());
+            w.put(static_cast<uint32_t>(student.getReserves().size()));
+            for (const auto* res : student.getReserves()) {
+                w.put(res->getReservationId());
+                w.put(static_cast<int32_t>(res->getMeal()->getMealId()));
+                w.put(static_cast<int32_t>(res->getDiningHall()->getHallId()));
+                w.put(res->getDate().getPacked());
+                w.put(res->getCreatedAt().getPacked());
+                w.put(static_cast<uint8_t>(res->getStatus()));
+            }
+            w.put(student.getTransactions().getArchived());
+            w.put(static_cast<uint32_t>(student.getTransactions().size()));
+            student.getTransactions().forEach([&](const Transaction& t) {
+                w.put(t.getTransactionID());
+                w.put(t.getAmount().getCents());
+                w.put(static_cast<uint8_t>(t.getType()));
+                w.put(static_cast<uint8_t>(t.getStatus()));
+                w.put(t.getCreatedAt().getPacked());
+                w.put(t.getTrackingCode());
+            });
+        }
+    }
+
+    static bool decode(Reader& r, const Header& h) {
+        Storage& storage = Storage::instance();
+        for (uint32_t i = 0; i < h.meals && r.good(); ++i) {
+            Meal meal;
+            meal.setMealId(r.get<int32_t>());
+            meal.setPrice(Money::fromCents(r.get<int64_t>()));
+            if (!r.get<uint8_t>()) meal.deactivate();
+            meal.setMealType(static_cast<MealType>(r.get<uint8_t>()));
+            meal.setReserveDay(static_cast<ReserveDay>(r.get<uint8_t>()));
+            meal.setName(r.getView());
+            uint32_t items = r.get<uint32_t>();
+            for (uint32_t k = 0; k < items && r.good(); ++k)
+                if (!meal.addSideItem(r.getView())) return false;
+            storage.addMeal(move(meal));
+        }
+        for (uint32_t i = 0; i < h.halls && r.good(); ++i) {
+            DiningHall hall;
+            hall.setHallId(r.get<int32_t>());
+            hall.setCapacity(r.get<int32_t>());
+            hall.setName(r.getString());
+            hall.setAddress(r.getString());
+            storage.addDiningHall(move(hall));
+        }
+        for (uint32_t i = 0; i < h.students && r.good(); ++i) {
+            int32_t userId = r.get<int32_t>();
+            Money balance = Money::fromCents(r.get<int64_t>());
+            bool active = r.get<uint8_t>();
+            string sid = r.getString();
+            string first = r.getString();
+            string last = r.getString();
+            string email = r.getString();
+            string phone = r.getString();
+            string pass = r.getString();
+            Student& student = storage.addStudent(
+                Student(userId, move(sid), move(first), move(last), move(email), move(phone), balance, move(pass)));
+            if (!active) student.deactivate();
+
+            uint32_t reservations = r.get<uint32_t>();
+            for (uint32_t k = 0; k < reservations && r.good(); ++k) {
+                uint64_t id = r.get<uint64_t>();
+                Meal* meal = storage.findMeal(r.get<int32_t>());
+                DiningHall* hall = storage.findDiningHall(r.get<int32_t>());
+                DateTime date = DateTime::fromPacked(r.get<uint32_t>());
+                DateTime createdAt = DateTime::fromPacked(r.get<uint32_t>());
+                RStatus status = static_cast<RStatus>(r.get<uint8_t>());
+                if (!meal || !hall) return false;
+                Reservation res(id, hall, meal);
+                res.setDate(date);
+                res.setCreatedAt(createdAt);
+                res.setStatus(status);
+                if (Reservation::holdsSeat(status))
+                    storage.reserveSeat(hall->getHallId(), date, meal->getMealType());
+                student.addReservation(&storage.addReservation(res, userId));
+                IDGenerator::observeReservationId(id);
+            }
+
+            uint64_t archived = r.get<uint64_t>();
+            HistoryArchive::instance().truncate(userId, archived);
+            student.restoreArchivedTransactions(archived);
+            uint32_t transactions = r.get<uint32_t>();
+            for (uint32_t k = 0; k < transactions && r.good(); ++k) {
+                Transaction t;
+                t.setTransactionID(r.get<uint64_t>());
+                t.setAmount(Money::fromCents(r.get<int64_t>()));
+                t.setType(static_cast<TransactionType>(r.get<uint8_t>()));
+                t.setStatus(static_cast<TransactionStatus>(r.get<uint8_t>()));
+                t.setCreatedAt(DateTime::fromPacked(r.get<uint32_t>()));
+                t.setTrackingCode(r.getString());
+                IDGenerator::observeTransactionId(t.getTransactionID());
+                storage.addTransaction(student, move(t));
+            }
+        }
+        return r.good();
+    }
+
+    static bool writeFile(const string& path, uint64_t walLsn) {
+        Writer body;
+        Header h;
+        memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.walLsn = walLsn;
+        encode(body, h);
+        h.bodySize = body.bytes().size();
+        h.bodyCrc = WalRecord::crc32c(reinterpret_cast<const uint8_t*>(body.bytes().data()), body.bytes().size());
+
+        string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = ::write(fd, &h, sizeof(h)) == static_cast<ssize_t>(sizeof(h));
+        size_t done = 0;
+        while (ok && done < body.bytes().size()) {
+            ssize_t n = ::write(fd, body.bytes().data() + done, body.bytes().size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            ok = n > 0;
+            if (ok) done += static_cast<size_t>(n);
+        }
+        ok = ok && fsync(fd) == 0;
+        ::close(fd);
+        return ok && rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    thread periodic;
+    mutex lock;
+    condition_variable wake;
+    bool stopping;
+
+    Snapshot() : stopping(false) {}
+    Snapshot(const Snapshot&) = delete;
+    void operator=(const Snapshot&) = delete;
+
+public:
+    static constexpr int kPeriodSeconds = 60;
+
+    static Snapshot& instance() {
+        static Snapshot snapshotInstance;
+        return snapshotInstance;
+    }
+
+    ~Snapshot() { stopPeriodic(); }
+
+    // Forks while briefly holding the commit gate; the child serializes its copy-on-write view of
+    // memory while the parent keeps serving requests. Returns true if the snapshot was written;
+    // walLsn receives the number of log records it covers.
+    static bool write(const string& path, uint64_t& walLsn) {
+        pid_t child;
+        {
+            unique_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            walLsn = WriteAheadLog::instance().getAppendedLsn();
+            child = fork();
+            if (child == 0) _exit(writeFile(path, walLsn) ? 0 : 1);
+        }
+        if (child < 0) return false;
+        int status = 0;
+        while (waitpid(child, &status, 0) < 0 && errno == EINTR) {}
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    static bool write(const string& path) {
+        uint64_t walLsn;
+        return write(path, walLsn);
+    }
+
+    // Maps the snapshot and rebuilds Storage from it. Returns false if it is missing or damaged, in which
+    // case walLsn is 0 and Storage may hold part of it; walLsn receives the number of log records it covers.
+    static bool load(const string& path, uint64_t& walLsn) {
+        walLsn = 0;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+        madvise(map, size, MADV_SEQUENTIAL);
+
+        const char* base = static_cast<const char*>(map);
+        Header h;
+        memcpy(&h, base, sizeof(h));
+        const char* body = base + sizeof(h);
+        bool ok = memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.bodySize == size - sizeof(h) &&
+                  h.bodyCrc == WalRecord::crc32c(reinterpret_cast<const uint8_t*>(body), h.bodySize);
+        if (ok) {
+            Reader r(body, body + h.bodySize);
+            ok = decode(r, h);
+        }
+        if (ok) walLsn = h.walLsn;
+        munmap(map, size);
+        return ok;
+    }
+
+    // Startup path: snapshot first, then only the log records written after it. Without a snapshot the
+    // whole log is replayed and re-spills every archived transaction, so the archives start over. Returns
+    // false, and the caller must not serve, if the snapshot is damaged or the log no longer reaches back to it.
+    static bool recover(const string& snapshotPath, const string& walPath, size_t& applied) {
+        applied = 0;
+        uint64_t lsn = 0;
+        if (!load(snapshotPath, lsn)) {
+            if (::access(snapshotPath.c_str(), F_OK) == 0) {
+                cout << snapshotPath << " is damaged" << endl;
+                return false;
+            }
+            for (auto& student : Storage::instance().getStudents()) {
+                HistoryArchive::instance().truncate(student.getUserId(), 0);
+                student.restoreArchivedTransactions(0);
+            }
+        }
+        bool ok = WriteAheadLog::replay(walPath, lsn, applied);
+        MenuCatalog::instance().rebuild();
+        return ok;
+    }
+
+    // Each snapshot that lands also drops the log records it covers.
+    void startPeriodic(const string& path, int intervalSeconds) {
+        stopPeriodic();
+        stopping = false;
+        periodic = thread([this, path, intervalSeconds] {
+            unique_lock<mutex> guard(lock);
+            while (!wake.wait_for(guard, chrono::seconds(intervalSeconds), [this] { return stopping; })) {
+                guard.unlock();
+                uint64_t lsn;
+                if (!write(path, lsn)) cout << "Snapshot to " << path << " failed" << endl;
+                else if (!WriteAheadLog::instance().discardBefore(lsn)) cout << "Could not trim the WAL after a snapshot" << endl;
+                guard.lock();
+            }
+        });
+    }
+
+    void stopPeriodic() {
+        if (!periodic.joinable()) return;
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        periodic.join();
+    }
+};
+
+constexpr char Snapshot::kMagic[8];
+
+// Streams semester menus and hall lists in and out, and loads the student roster and staff list. CSV files carry a header line,
+// any field may be double-quoted, and a meal's sides (at most kMaxSides) are ';'-separated. The binary form is a
+// 24-byte header followed by length-prefixed records. Imports map the file, validate every row, then insert in
+// batches, so a bad row leaves Storage untouched. Like the rest of setup, imports must not run alongside other
+// writers of meals, halls or students.
+class BulkCatalog {
+    static constexpr char kMagic[8] = {'R', 'S', 'V', 'C', 'A', 'T', '0', '1'};
+    static constexpr uint32_t kMealKind = 1;
+    static constexpr uint32_t kHallKind = 2;
+    static constexpr uint32_t kStudentKind = 3;
+    static constexpr uint32_t kStaffKind = 4;
+    static constexpr size_t kBatch = 4096;
+    static constexpr size_t kMaxSides = Meal::kMaxSideItems;
+    static constexpr size_t kMaxBinaryString = 0xFFFF;
+    static constexpr string_view kMealHeader = "name,price,type,day,active,sides";
+    static constexpr string_view kHallHeader = "name,address,capacity";
+    static constexpr string_view kStudentHeader = "user_id,student_id,name,last_name,email,phone,password_hash,balance";
+    static constexpr string_view kStaffHeader = "user_id,name,last_name,password_hash";
+
+    struct Header {
+        char magic[8];
+        uint32_t kind;
+        uint32_t reserved;
+        uint64_t count;
+    };
+    static_assert(sizeof(Header) == 24, "catalog header is written as a raw block");
+
+    struct MealFields {
+        string_view name;
+        Money price;
+        MealType type;
+        ReserveDay day;
+        bool active;
+        array<string_view, kMaxSides> sides;
+        size_t sideCount;
+    };
+
+    struct HallFields {
+        string_view name;
+        string_view address;
+        int capacity;
+    };
+
+    struct StudentFields {
+        int userId;
+        array<string_view, 6> text;  // student id, name, last name, email, phone, password hash
+        Money balance;
+    };
+
+    struct StaffFields {
+        int userId;
+        array<string_view, 3> text;  // name, last name, password hash
+    };
+
+    class MappedFile {
+        const char* base;
+        size_t length;
+
+    public:
+        explicit MappedFile(const string& path) : base(nullptr), length(0) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (map != MAP_FAILED) {
+                    base = static_cast<const char*>(map);
+                    length = static_cast<size_t>(st.st_size);
+                    madvise(map, length, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+        }
+        ~MappedFile() {
+            if (base) munmap(const_cast<char*>(base), length);
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool good() const { return base != nullptr; }
+        string_view bytes() const { return string_view(base, length); }
+    };
+
+    // Hands out one CSV record at a time as views into the mapping.
+    class CsvReader {
+        string_view rest;
+        size_t line;
+
+    public:
+        CsvReader(string_view data, size_t firstLine) : rest(data), line(firstLine) {}
+
+        size_t getLine() const { return line; }
+
+        // False at end of input. A record with more than N fields reports N + 1 so callers can reject it.
+        template <size_t N>
+        bool next(array<string_view, N>& fields, size_t& count) {
+            while (!rest.empty() && (rest[0] == '\n' || rest[0] == '\r')) {
+                if (rest[0] == '\n') ++line;
+                rest.remove_prefix(1);
+            }
+            if (rest.empty()) return false;
+            ++line;
+            count = 0;
+            size_t i = 0;
+            for (;;) {
+                size_t begin = i;
+                if (i < rest.size() && rest[i] == '"') {
+                    for (++i; i < rest.size(); ++i) {
+                        if (rest[i] != '"') continue;
+                        if (i + 1 < rest.size() && rest[i + 1] == '"') ++i;
+                        else break;
+                    }
+                    if (i < rest.size()) ++i;
+                }
+                while (i < rest.size() && rest[i] != ',' && rest[i] != '\n') ++i;
+                string_view field = rest.substr(begin, i - begin);
+                if (!field.empty() && field.back() == '\r') field.remove_suffix(1);
+                if (count < N) fields[count] = field;
+                if (count <= N) ++count;
+                if (i >= rest.size() || rest[i] == '\n') break;
+                ++i;
+            }
+            rest.remove_prefix(min(i + 1, rest.size()));
+            return true;
+        }
+    };
+
+    // Strips quotes; only fields holding an escaped quote are copied, into scratch.
+    static string_view unquote(string_view field, string& scratch) {
+        if (field.size() < 2 || field.front() != '"' || field.back() != '"') return field;
+        field = field.substr(1, field.size() - 2);
+        if (field.find('"') == string_view::npos) return field;
+        scratch.clear();
+        for (size_t i = 0; i < field.size(); ++i) {
+            scratch.push_back(field[i]);
+            if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"') ++i;
+        }
+        return scratch;
+    }
+
+    template <typename T>
+    static bool number(string_view s, T& out) {
+        auto r = from_chars(s.data(), s.data() + s.size(), out);
+        return !s.empty() && r.ec == errc() && r.ptr == s.data() + s.size();
+    }
+
+    static constexpr const char* kTypeNames[3] = {"breakfast", "lunch", "dinner"};
+    static constexpr const char* kDayNames[5] = {"saturday", "sunday", "monday", "tuesday", "wednesday"};
+
+    template <size_t N>
+    static bool lookup(string_view s, const char* const (&names)[N], int& out) {
+        for (size_t i = 0; i < N; ++i)
+            if (s == names[i]) {
+                out = static_cast<int>(i);
+                return true;
+            }
+        return false;
+    }
+
+    // Every field goes through unquote; each gets its own scratch so one escape cannot clobber another.
+    template <size_t N>
+    static void unquoteAll(array<string_view, N>& f, size_t count, array<string, N>& scratch) {
+        for (size_t i = 0; i < min(count, N); ++i) f[i] = unquote(f[i], scratch[i]);
+    }
+
+    static bool csvMeal(array<string_view, 6> f, size_t count, array<string, 6>& scratch, MealFields& m) {
+        if (count < 5 || count > 6) return false;
+        unquoteAll(f, count, scratch);
+        m.name = f[0];
+        int type = 0, day = 0;
+        if (m.name.empty() || !Money::parse(f[1].data(), f[1].size(), m.price) || m.price.getCents() < 0 ||
+            !lookup(f[2], kTypeNames, type) || !lookup(f[3], kDayNames, day) || (f[4] != "0" && f[4] != "1"))
+            return false;
+        m.type = static_cast<MealType>(type);
+        m.day = static_cast<ReserveDay>(day);
+        m.active = f[4] == "1";
+        m.sideCount = 0;
+        string_view sides = count == 6 ? f[5] : string_view();
+        while (!sides.empty()) {
+            size_t cut = sides.find(';');
+            string_view item = sides.substr(0, cut);
+            if (item.empty() || m.sideCount == m.sides.size()) return false;
+            m.sides[m.sideCount++] = item;
+            sides = cut == string_view::npos ? string_view() : sides.substr(cut + 1);
+        }
+        return true;
+    }
+
+    static bool csvHall(array<string_view, 3> f, size_t count, array<string, 3>& scratch, HallFields& h) {
+        if (count != 3) return false;
+        unquoteAll(f, count, scratch);
+        h.name = f[0];
+        h.address = f[1];
+        return !h.name.empty() && number(f[2], h.capacity) && h.capacity > 0;
+    }
+
+    static bool csvStudent(array<string_view, 8> f, size_t count, array<string, 8>& scratch, StudentFields& s) {
+        if (count != 8) return false;
+        unquoteAll(f, count, scratch);
+        for (size_t i = 0; i < s.text.size(); ++i) s.text[i] = f[i + 1];
+        return number(f[0], s.userId) && s.userId > 0 && !s.text[0].empty() &&
+               Money::parse(f[7].data(), f[7].size(), s.balance) && s.balance.getCents() >= 0;
+    }
+
+    static bool csvStaff(array<string_view, 4> f, size_t count, array<string, 4>& scratch, StaffFields& s) {
+        if (count != 4) return false;
+        unquoteAll(f, count, scratch);
+        for (size_t i = 0; i < s.text.size(); ++i) s.text[i] = f[i + 1];
+        return number(f[0], s.userId) && s.userId > 0 && !s.text[2].empty();
+    }
+
+    // Reads native-endian fields and length-prefixed strings without copying them.
+    class ByteCursor {
+        string_view rest;
+        bool ok;
+
+    public:
+        explicit ByteCursor(string_view data) : rest(data), ok(true) {}
+
+        template <typename T>
+        T get() {
+            T value{};
+            if (rest.size() < sizeof(T)) {
+                ok = false;
+                return value;
+            }
+            memcpy(&value, rest.data(), sizeof(T));
+            rest.remove_prefix(sizeof(T));
+            return value;
+        }
+        string_view bytes(size_t n) {
+            if (rest.size() < n) {
+                ok = false;
+                return {};
+            }
+            string_view out = rest.substr(0, n);
+            rest.remove_prefix(n);
+            return out;
+        }
+        bool good() const { return ok; }
+        bool done() const { return rest.empty(); }
+    };
+
+    static bool binaryMeal(ByteCursor& c, MealFields& m) {
+        m.price = Money::fromCents(c.get<int64_t>());
+        uint8_t type = c.get<uint8_t>(), day = c.get<uint8_t>(), active = c.get<uint8_t>();
+        m.sideCount = c.get<uint8_t>();
+        m.name = c.bytes(c.get<uint16_t>());
+        if (!c.good() || m.name.empty() || m.price.getCents() < 0 || type > 2 || day > 4 || active > 1 ||
+            m.sideCount > m.sides.size())
+            return false;
+        m.type = static_cast<MealType>(type);
+        m.day = static_cast<ReserveDay>(day);
+        m.active = active;
+        for (size_t i = 0; i < m.sideCount; ++i) {
+            m.sides[i] = c.bytes(c.get<uint16_t>());
+            if (m.sides[i].empty()) return false;
+        }
+        return c.good();
+    }
+
+    static bool binaryHall(ByteCursor& c, HallFields& h) {
+        h.capacity = c.get<int32_t>();
+        uint16_t nameLen = c.get<uint16_t>(), addressLen = c.get<uint16_t>();
+        h.name = c.bytes(nameLen);
+        h.address = c.bytes(addressLen);
+        return c.good() && !h.name.empty() && h.capacity > 0;
+    }
+
+    static bool binaryStudent(ByteCursor& c, StudentFields& s) {
+        s.userId = c.get<int32_t>();
+        s.balance = Money::fromCents(c.get<int64_t>());
+        for (auto& field : s.text) field = c.bytes(c.get<uint16_t>());
+        return c.good() && s.userId > 0 && !s.text[0].empty() && s.balance.getCents() >= 0;
+    }
+
+    static bool binaryStaff(ByteCursor& c, StaffFields& s) {
+        s.userId = c.get<int32_t>();
+        for (auto& field : s.text) field = c.bytes(c.get<uint16_t>());
+        return c.good() && s.userId > 0 && !s.text[2].empty();
+    }
+
+    static Meal build(const MealFields& m) {
+        Meal meal;
+        meal.setMealId(Storage::instance().generateMealId());
+        meal.setName(m.name);
+        meal.setPrice(m.price);
+        meal.setMealType(m.type);
+        meal.setReserveDay(m.day);
+        if (!m.active) meal.deactivate();
+        for (size_t i = 0; i < m.sideCount; ++i) meal.addSideItem(m.sides[i]);
+        return meal;
+    }
+
+    static DiningHall build(const HallFields& h) {
+        DiningHall hall;
+        hall.setHallId(Storage::instance().generateDiningHallId());
+        hall.setName(string(h.name));
+        hall.setAddress(string(h.address));
+        hall.setCapacity(h.capacity);
+        return hall;
+    }
+
+    static Student build(const StudentFields& s) {
+        return Student(s.userId, string(s.text[0]), string(s.text[1]), string(s.text[2]), string(s.text[3]),
+                       string(s.text[4]), s.balance, string(s.text[5]));
+    }
+    static Admin build(const StaffFields& s) {
+        return Admin(s.userId, string(s.text[0]), string(s.text[1]), string(s.text[2]));
+    }
+
+    // Validates the header and decodes every row into each(fields); stops at the first bad row.
+    template <typename Fields, size_t N, typename CsvDecode, typename BinaryDecode, typename Each>
+    static bool scan(string_view data, uint32_t kind, string_view csvHeader, CsvDecode&& csvDecode,
+                     BinaryDecode&& binaryDecode, Each&& each, ImportReport& report) {
+        Fields fields;
+        report.rows = 0;
+        auto fail = [&](ImportStatus status, size_t where) {
+            report.status = status;
+            report.badRow = where;
+            return false;
+        };
+        if (data.size() >= sizeof(kMagic) && memcmp(data.data(), kMagic, sizeof(kMagic)) == 0) {
+            Header h;
+            if (data.size() < sizeof(h)) return fail(ImportStatus::BAD_HEADER, 0);
+            memcpy(&h, data.data(), sizeof(h));
+            if (h.kind != kind) return fail(ImportStatus::BAD_HEADER, 0);
+            ByteCursor c(data.substr(sizeof(h)));
+            for (uint64_t i = 0; i < h.count; ++i) {
+                if (!binaryDecode(c, fields)) return fail(ImportStatus::BAD_ROW, i + 1);
+                each(fields);
+                ++report.rows;
+            }
+            return c.done() || fail(ImportStatus::BAD_ROW, h.count + 1);
+        }
+
+        size_t eol = data.find('\n');
+        string_view header = data.substr(0, eol);
+        if (!header.empty() && header.back() == '\r') header.remove_suffix(1);
+        if (header != csvHeader) return fail(ImportStatus::BAD_HEADER, 1);
+        CsvReader reader(eol == string_view::npos ? string_view() : data.substr(eol + 1), 1);
+        array<string_view, N> f;
+        size_t count = 0;
+        while (reader.next(f, count)) {
+            if (!csvDecode(f, count, fields)) return fail(ImportStatus::BAD_ROW, reader.getLine());
+            each(fields);
+            ++report.rows;
+        }
+        return true;
+    }
+
+    class OutBuffer {
+        int fd;
+        size_t used;
+        bool ok;
+        char buf[64 * 1024];
+
+    public:
+        explicit OutBuffer(const string& path) : fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), used(0), ok(fd >= 0) {}
+        ~OutBuffer() {
+            if (fd >= 0) ::close(fd);
+        }
+        OutBuffer(const OutBuffer&) = delete;
+        OutBuffer& operator=(const OutBuffer&) = delete;
+
+        void flush() {
+            size_t done = 0;
+            while (ok && done < used) {
+                ssize_t n = ::write(fd, buf + done, used - done);
+                if (n < 0 && errno == EINTR) continue;
+                ok = n > 0;
+                if (ok) done += static_cast<size_t>(n);
+            }
+            used = 0;
+        }
+        void put(const void* data, size_t n) {
+            const char* p = static_cast<const char*>(data);
+            while (n) {
+                if (used == sizeof(buf)) flush();
+                size_t k = min(n, sizeof(buf) - used);
+                memcpy(buf + used, p, k);
+                used += k;
+                p += k;
+                n -= k;
+            }
+        }
+        void put(string_view s) { put(s.data(), s.size()); }
+        void put(char c) { put(&c, 1); }
+        template <typename T>
+        void value(T v) { put(&v, sizeof(v)); }
+        void money(Money m) {
+            char tmp[Money::kMaxFormattedSize];
+            put(tmp, static_cast<size_t>(m.format(tmp) - tmp));
+        }
+        void number(int64_t v) {
+            char tmp[24];
+            put(tmp, static_cast<size_t>(to_chars(tmp, tmp + sizeof(tmp), v).ptr - tmp));
+        }
+        void csvField(string_view s) {
+            if (s.find_first_of(",\"\r\n") == string_view::npos) return put(s);
+            put('"');
+            for (char c : s) {
+                if (c == '"') put('"');
+                put(c);
+            }
+            put('"');
+        }
+        bool close() {
+            flush();
+            bool closed = fd >= 0 && ::close(fd) == 0;
+            fd = -1;
+            return ok && closed;
+        }
+    };
+
+    static void writeHeader(OutBuffer& out, uint32_t kind, uint64_t count) {
+        Header h{};
+        memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.kind = kind;
+        h.count = count;
+        out.value(h);
+    }
+
+    // Each batch goes into Storage and the log together; lsn receives the last record logged.
+    template <typename T>
+    static void finishBatch(vector<T>& batch, ImportReport& report, void (Storage::*add)(vector<T>&), uint64_t& lsn) {
+        if (batch.empty()) return;
+        if (!report.firstId) report.firstId = idOf(batch.front());
+        thread_local vector<WalRecord> records;
+        records.clear();
+        for (const T& item : batch) describe(item, records);
+        {
+            shared_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            (Storage::instance().*add)(batch);
+            if (uint64_t last = WriteAheadLog::instance().append(records.data(), records.size())) lsn = last;
+        }
+        batch.clear();
+    }
+    static void describe(const Meal& m, vector<WalRecord>& out) { WalRecord::meal(m, out); }
+    static void describe(const DiningHall& h, vector<WalRecord>& out) { WalRecord::hall(h, out); }
+    static void describe(const Student& s, vector<WalRecord>& out) { WalRecord::student(s, out); }
+
+    static void finishImport(ImportReport& report, uint64_t lsn) {
+        if (lsn && !WriteAheadLog::instance().waitDurable(lsn)) report.status = ImportStatus::NOT_DURABLE;
+    }
+    static int idOf(const Meal& m) { return m.getMealId(); }
+    static int idOf(const DiningHall& h) { return h.getHallId(); }
+    static int idOf(const Student& s) { return s.getUserId(); }
+
+public:
+    static ImportReport importMeals(const string& path) {
+        ImportReport report;
+        MappedFile file(path);
+        if (!file.good()) {
+            report.status = ImportStatus::OPEN_FAILED;
+            return report;
+        }
+        array<string, 6> scratch;
+        auto csv = [&](const array<string_view, 6>& f, size_t n, MealFields& m) { return csvMeal(f, n, scratch, m); };
+        if (!scan<MealFields, 6>(file.bytes(), kMealKind, kMealHeader, csv, binaryMeal, [](const MealFields&) {}, report))
+            return report;
+
+        Storage& storage = Storage::instance();
+        storage.reserveMeals(report.rows);
+        vector<Meal> batch;
+        batch.reserve(min(kBatch, report.rows));
+        uint64_t lsn = 0;
+        scan<MealFields, 6>(file.bytes(), kMealKind, kMealHeader, csv, binaryMeal, [&](const MealFields& m) {
+            batch.push_back(build(m));
+            if (batch.size() == kBatch) finishBatch(batch, report, &Storage::addMeals, lsn);
+        }, report);
+        finishBatch(batch, report, &Storage::addMeals, lsn);
+        MenuCatalog::instance().refresh();
+        finishImport(report, lsn);
+        return report;
+    }
+
+    static ImportReport importHalls(const string& path) {
+        ImportReport report;
+        MappedFile file(path);
+        if (!file.good()) {
+            report.status = ImportStatus::OPEN_FAILED;
+            return report;
+        }
+        array<string, 3> scratch;
+        auto csv = [&](const array<string_view, 3>& f, size_t n, HallFields& h) { return csvHall(f, n, scratch, h); };
+        if (!scan<HallFields, 3>(file.bytes(), kHallKind, kHallHeader, csv, binaryHall, [](const HallFields&) {}, report))
+            return report;
+
+        vector<DiningHall> batch;
+        batch.reserve(min(kBatch, report.rows));
+        uint64_t lsn = 0;
+        scan<HallFields, 3>(file.bytes(), kHallKind, kHallHeader, csv, binaryHall, [&](const HallFields& h) {
+            batch.push_back(build(h));
+            if (batch.size() == kBatch) finishBatch(batch, report, &Storage::addDiningHalls, lsn);
+        }, report);
+        finishBatch(batch, report, &Storage::addDiningHalls, lsn);
+        finishImport(report, lsn);
+        return report;
+    }
+
+    // Rows are students with their opening balance; a user id already registered, or repeated, is a bad row.
+    static ImportReport importStudents(const string& path) {
+        ImportReport report;
+        MappedFile file(path);
+        if (!file.good()) {
+            report.status = ImportStatus::OPEN_FAILED;
+            return report;
+        }
+        Storage& storage = Storage::instance();
+        unordered_set<int> seen;
+        bool validating = true;
+        auto fresh = [&](const StudentFields& s) {
+            return !validating || (!storage.findStudent(s.userId) && seen.insert(s.userId).second);
+        };
+        array<string, 8> scratch;
+        auto csv = [&](const array<string_view, 8>& f, size_t n, StudentFields& s) {
+            return csvStudent(f, n, scratch, s) && fresh(s);
+        };
+        auto binary = [&](ByteCursor& c, StudentFields& s) { return binaryStudent(c, s) && fresh(s); };
+        if (!scan<StudentFields, 8>(file.bytes(), kStudentKind, kStudentHeader, csv, binary,
+                                    [](const StudentFields&) {}, report))
+            return report;
+        validating = false;
+
+        vector<Student> batch;
+        batch.reserve(min(kBatch, report.rows));
+        uint64_t lsn = 0;
+        scan<StudentFields, 8>(file.bytes(), kStudentKind, kStudentHeader, csv, binary, [&](const StudentFields& s) {
+            batch.push_back(build(s));
+            if (batch.size() == kBatch) finishBatch(batch, report, &Storage::addStudents, lsn);
+        }, report);
+        finishBatch(batch, report, &Storage::addStudents, lsn);
+        finishImport(report, lsn);
+        return report;
+    }
+
+    // Rows are hall staff who may look reservations up and check students in. Staff ids are their own namespace
+    // (staff log in with STAFF, not LOGIN); one already loaded, or repeated, is a bad row. Nothing is logged.
+    static ImportReport importStaff(const string& path) {
+        ImportReport report;
+        MappedFile file(path);
+        if (!file.good()) {
+            report.status = ImportStatus::OPEN_FAILED;
+            return report;
+        }
+        Storage& storage = Storage::instance();
+        unordered_set<int> seen;
+        bool validating = true;
+        auto fresh = [&](const StaffFields& s) {
+            return !validating || (!storage.findStaff(s.userId) && seen.insert(s.userId).second);
+        };
+        array<string, 4> scratch;
+        auto csv = [&](const array<string_view, 4>& f, size_t n, StaffFields& s) {
+            return csvStaff(f, n, scratch, s) && fresh(s);
+        };
+        auto binary = [&](ByteCursor& c, StaffFields& s) { return binaryStaff(c, s) && fresh(s); };
+        if (!scan<StaffFields, 4>(file.bytes(), kStaffKind, kStaffHeader, csv, binary, [](const StaffFields&) {}, report))
+            return report;
+        validating = false;
+
+        vector<Admin> batch;
+        batch.reserve(report.rows);
+        scan<StaffFields, 4>(file.bytes(), kStaffKind, kStaffHeader, csv, binary,
+                             [&](const StaffFields& s) { batch.push_back(build(s)); }, report);
+        storage.addStaff(batch);
+        return report;
+    }
+
+    // Checked before the file is opened, so a meal the format cannot hold fails the export without truncating
+    // anything: binary lengths are 16-bit, and ';' inside a CSV side item would split it on import.
+    static bool exportable(const Meal& meal, BulkFormat format) {
+        bool binary = format == BulkFormat::BINARY;
+        if (binary && meal.getName().size() > kMaxBinaryString) return false;
+        for (size_t i = 0; i < meal.getSideItemCount(); ++i) {
+            string_view item = meal.getSideItem(i);
+            if (binary ? item.size() > kMaxBinaryString : item.find(';') != string_view::npos) return false;
+        }
+        return true;
+    }
+
+    static bool exportMeals(const string& path, BulkFormat format) {
+        StableVector<Meal>& meals = Storage::instance().getMeals();
+        for (auto& meal : meals)
+            if (!exportable(meal, format)) return false;
+        OutBuffer out(path);
+        if (format == BulkFormat::BINARY) {
+            writeHeader(out, kMealKind, meals.size());
+            for (auto& meal : meals) {
+                out.value(meal.getPrice().getCents());
+                out.value(static_cast<uint8_t>(meal.getMealType()));
+                out.value(static_cast<uint8_t>(meal.getReserveDay()));
+                out.value(static_cast<uint8_t>(meal.getIsActive()));
+                out.value(static_cast<uint8_t>(meal.getSideItemCount()));
+                out.value(static_cast<uint16_t>(meal.getName().size()));
+                out.put(meal.getName());
+                for (size_t i = 0; i < meal.getSideItemCount(); ++i) {
+                    out.value(static_cast<uint16_t>(meal.getSideItem(i).size()));
+                    out.put(meal.getSideItem(i));
+                }
+            }
+            return out.close();
+        }
+        out.put(kMealHeader);
+        out.put('\n');
+        string sides;
+        for (auto& meal : meals) {
+            out.csvField(meal.getName());
+            out.put(',');
+            out.money(meal.getPrice());
+            out.put(',');
+            out.put(kTypeNames[static_cast<int>(meal.getMealType())]);
+            out.put(',');
+            out.put(kDayNames[static_cast<int>(meal.getReserveDay())]);
+            out.put(meal.getIsActive() ? ",1," : ",0,");
+            sides.clear();
+            for (size_t i = 0; i < meal.getSideItemCount(); ++i) {
+                if (i) sides.push_back(';');
+                sides.append(meal.getSideItem(i));
+            }
+            out.csvField(sides);
+            out.put('\n');
+        }
+        return out.close();
+    }
+
+    static bool exportHalls(const string& path, BulkFormat format) {
+        StableVector<DiningHall>& halls = Storage::instance().getDiningHalls();
+        for (auto& hall : halls)
+            if (format == BulkFormat::BINARY &&
+                (hall.getName().size() > kMaxBinaryString || hall.getAddress().size() > kMaxBinaryString))
+                return false;
+        OutBuffer out(path);
+        if (format == BulkFormat::BINARY) {
+            writeHeader(out, kHallKind, halls.size());
+            for (auto& hall : halls) {
+                out.value(static_cast<int32_t>(hall.getCapacity()));
+                out.value(static_cast<uint16_t>(hall.getName().size()));
+                out.value(static_cast<uint16_t>(hall.getAddress().size()));
+                out.put(hall.getName());
+                out.put(hall.getAddress());
+            }
+            return out.close();
+        }
+        out.put(kHallHeader);
+        out.put('\n');
+        for (auto& hall : halls) {
+            out.csvField(hall.getName());
+            out.put(',');
+            out.csvField(hall.getAddress());
+            out.put(',');
+            out.number(hall.getCapacity());
+            out.put('\n');
+        }
+        return out.close();
+    }
+};
+
+constexpr char BulkCatalog::kMagic[8];
+constexpr const char* BulkCatalog::kTypeNames[3];
+constexpr const char* BulkCatalog::kDayNames[5];
+
+// Admin changes to meals and the roster are logged like bookings, so a restart replays them on top of the last
+// snapshot. Each returns false if there was nothing to change or the change could not be made durable.
+class CatalogJournal {
+    static bool durable(uint64_t lsn) { return !lsn || WriteAheadLog::instance().waitDurable(lsn); }
+
+public:
+    template <typename F>
+    static bool changeMeal(int mealId, F&& change) {
+        uint64_t lsn = 0;
+        bool found;
+        {
+            shared_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            found = MenuCatalog::instance().update(mealId, [&](Meal& meal) {
+                change(meal);
+                WalRecord record = WalRecord::mealState(meal);
+                lsn = WriteAheadLog::instance().append(&record, 1);
+            });
+        }
+        return found && durable(lsn);
+    }
+
+    // Registrations are serialised here; false also when the user id is taken.
+    static bool addStudent(Student student) {
+        static mutex registering;
+        lock_guard<mutex> guard(registering);
+        Storage& storage = Storage::instance();
+        if (storage.findStudent(student.getUserId())) return false;
+        thread_local vector<WalRecord> records;
+        records.clear();
+        WalRecord::student(student, records);
+        uint64_t lsn;
+        {
+            shared_lock<shared_mutex> gate(storage.getCommitGate());
+            storage.addStudent(move(student));
+            lsn = WriteAheadLog::instance().append(records.data(), records.size());
+        }
+        return durable(lsn);
+    }
+};
+
+bool Admin::updateMealPrice(int mealId, Money price) {
+    return CatalogJournal::changeMeal(mealId, [&](Meal& m) { m.updatePrice(price); });
+}
+bool Admin::deactivateMeal(int mealId) {
+    return CatalogJournal::changeMeal(mealId, [](Meal& m) { m.deactivate(); });
+}
+bool Admin::activateMeal(int mealId) {
+    return CatalogJournal::changeMeal(mealId, [](Meal& m) { m.activate(); });
+}
+bool Admin::addStudent(Student student) { return CatalogJournal::addStudent(move(student)); }
+bool Admin::importMeals(const string& path, ImportReport& report) {
+    report = BulkCatalog::importMeals(path);
+    return report.status == ImportStatus::OK;
+}
+bool Admin::importHalls(const string& path, ImportReport& report) {
+    report = BulkCatalog::importHalls(path);
+    return report.status == ImportStatus::OK;
+}
+bool Admin::importStudents(const string& path, ImportReport& report) {
+    report = BulkCatalog::importStudents(path);
+    return report.status == ImportStatus::OK;
+}
+bool Admin::importStaff(const string& path, ImportReport& report) {
+    report = BulkCatalog::importStaff(path);
+    return report.status == ImportStatus::OK;
+}
+bool Admin::exportMeals(const string& path, BulkFormat format) { return BulkCatalog::exportMeals(path, format); }
+bool Admin::exportHalls(const string& path, BulkFormat format) { return BulkCatalog::exportHalls(path, format); }
+
+class BalanceLedger {
+    static Transaction record(Money amount, TransactionType type, TransactionStatus status) {
+        Transaction t;
+        t.setTransactionID(IDGenerator::generateTransactionId());
+        t.setAmount(amount);
+        t.setType(type);
+        t.setStatus(status);
+        return t;
+    }
+
+public:
+    // A credit the balance cannot hold comes back FAILED, like an overdrawing debit.
+    static Transaction credit(Student& student, Money amount) {
+        bool added = student.credit(amount);
+        return record(amount, TransactionType::TRANSFER, added ? TransactionStatus::COMPLETED : TransactionStatus::FAILED);
+    }
+
+    // A debit that would overdraw leaves the balance untouched and comes back FAILED.
+    static Transaction debit(Student& student, Money amount) {
+        bool paid = student.tryDebit(amount);
+        return record(amount, TransactionType::PAYMENT, paid ? TransactionStatus::COMPLETED : TransactionStatus::FAILED);
+    }
+};
+
+class CheckoutEngine {
+    static void releaseSeats(const vector<Reservation>& items, size_t count) {
+        Storage& storage = Storage::instance();
+        for (size_t i = 0; i < count; ++i) {
+            Meal* meal = items[i].getMeal();
+            storage.releaseSeat(items[i].getDiningHall()->getHallId(), items[i].getDate(), meal->getMealType());
+        }
+    }
+
+    static CheckoutStatus reject(const Student& student, const Reservation& res, CheckoutStatus status, EventCode code) {
+        EventLog::instance().log(code, student.getUserId(), res.getDiningHall()->getHallId(), res.getDate(),
+                                 res.getMeal()->getMealType());
+        return status;
+    }
+
+public:
+    static CheckoutStatus commit(Student& student, ShoppingCart& cart) {
+        const vector<Reservation>& items = cart.getReservations();
+        if (items.empty()) return CheckoutStatus::EMPTY_CART;
+
+        Money total;
+        {
+            MenuCatalog::Reader menu;
+            for (size_t i = 0; i < items.size(); ++i) {
+                const Reservation& res = items[i];
+                const MenuCatalog::Item* item = menu->find(res.getMeal()->getMealId());
+                if (!item || !item->active)
+                    return reject(student, res, CheckoutStatus::INACTIVE_MEAL, EventCode::INACTIVE_MEAL);
+                bool duplicate = student.hasActiveReservationFor(res.getDate(), item->mealType);
+                for (size_t j = 0; j < i && !duplicate; ++j)
+                    duplicate = items[j].getDate().getDay() == res.getDate().getDay() &&
+                                items[j].getMeal()->getMealType() == item->mealType;
+                if (duplicate) return reject(student, res, CheckoutStatus::ALREADY_RESERVED, EventCode::ALREADY_RESERVED);
+                // No balance can cover a total that does not fit in Money.
+                if (!total.tryAdd(item->price))
+                    return reject(student, res, CheckoutStatus::INSUFFICIENT_BALANCE, EventCode::INSUFFICIENT_BALANCE);
+            }
+        }
+        if (student.getAccountBalance() < total)
+            return reject(student, items.front(), CheckoutStatus::INSUFFICIENT_BALANCE, EventCode::INSUFFICIENT_BALANCE);
+
+        Storage& storage = Storage::instance();
+        for (size_t i = 0; i < items.size(); ++i) {
+            Meal* meal = items[i].getMeal();
+            if (!storage.reserveSeat(items[i].getDiningHall()->getHallId(), items[i].getDate(), meal->getMealType())) {
+                releaseSeats(items, i);
+                return reject(student, items[i], CheckoutStatus::HALL_FULL, EventCode::HALL_FULL);
+            }
+        }
+
+        try {
+            storage.reserveHistory(student, items.size(), 1);
+        } catch (...) {
+            releaseSeats(items, items.size());
+            throw;
+        }
+
+        thread_local vector<WalRecord> records;
+        records.clear();
+        uint64_t lsn;
+        {
+            shared_lock<shared_mutex> gate(storage.getCommitGate());
+            Transaction t = BalanceLedger::debit(student, total);
+            if (t.getStatus() != TransactionStatus::COMPLETED) {
+                gate.unlock();
+                releaseSeats(items, items.size());
+                return reject(student, items.front(), CheckoutStatus::INSUFFICIENT_BALANCE, EventCode::INSUFFICIENT_BALANCE);
+            }
+            records.push_back(WalRecord::transaction(student.getUserId(), t));
+            storage.addTransaction(student, move(t));
+            storage.addReservations(items, student.getUserId(), [&](Reservation& r) {
+                r.setStatus(RStatus::SUCCESS);
+                student.addReservation(&r);
+                records.push_back(WalRecord::reservation(student.getUserId(), r));
+            });
+            lsn = WriteAheadLog::instance().append(records.data(), records.size());
+        }
+        cart.clear();
+        if (lsn && !WriteAheadLog::instance().awaitDurable(lsn)) return CheckoutStatus::NOT_DURABLE;
+        return CheckoutStatus::CONFIRMED;
+    }
+};
+
+// Reservation operations keyed by id alone: cancellations and the door scanners at each hall.
+class ReservationDesk {
+public:
+    static bool lookup(uint64_t id, ReservationIndex::Entry& out) { return Storage::instance().findReservation(id, out); }
+
+    // Callers serialise actions of the owning student, as the server does with its per-student lock.
+    static TicketStatus cancel(Student& student, uint64_t id) {
+        ReservationIndex::Entry e;
+        if (!lookup(id, e)) return TicketStatus::NOT_FOUND;
+        if (e.studentId != student.getUserId()) return TicketStatus::NOT_OWNER;
+        WalRecord record = WalRecord::cancellation(student.getUserId(), id);
+        uint64_t lsn;
+        {
+            shared_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            if (!student.cancelReservation(e.reservation)) return TicketStatus::NOT_ACTIVE;
+            lsn = WriteAheadLog::instance().append(&record, 1);
+        }
+        if (lsn && !WriteAheadLog::instance().awaitDurable(lsn)) return TicketStatus::NOT_DURABLE;
+        return TicketStatus::OK;
+    }
+
+    static TicketStatus checkIn(uint64_t id, int hallId, DateTime today) {
+        ReservationIndex::Entry e;
+        if (!lookup(id, e)) return TicketStatus::NOT_FOUND;
+        if (e.hallId != hallId) return TicketStatus::WRONG_HALL;
+        if (e.reservation->getDate().getDay() != today.getDay()) return TicketStatus::WRONG_DAY;
+        WalRecord record = WalRecord::checkIn(e.studentId, id);
+        uint64_t lsn;
+        {
+            shared_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            if (!e.reservation->transition(RStatus::SUCCESS, RStatus::CHECKED_IN)) return TicketStatus::NOT_ACTIVE;
+            lsn = WriteAheadLog::instance().append(&record, 1);
+        }
+        if (lsn && !WriteAheadLog::instance().awaitDurable(lsn)) return TicketStatus::NOT_DURABLE;
+        return TicketStatus::OK;
+    }
+};
+
+// SKIPPED leaves the seat with the caller for the next waiter. NOT_DURABLE means the booking could not be logged
+// and was taken back, refund included; the seat is still the caller's.
+WaitlistEngine::SeatResult WaitlistEngine::seat(const Waiter& w) {
+    Storage& storage = Storage::instance();
+    lock_guard<mutex> studentGuard(storage.getStudentLock(w.studentId));
+    Student* student = storage.findStudent(w.studentId);
+    Meal* meal = w.meal;
+    DateTime date = w.date;
+    if (!student || date.getDay() < DateTime::now().getDay() || student->hasActiveReservationFor(date, meal->getMealType()))
+        return SeatResult::SKIPPED;
+    Money price;
+    {
+        MenuCatalog::Reader menu;
+        const MenuCatalog::Item* item = menu->find(meal->getMealId());
+        if (!item || !item->active) {
+            EventLog::instance().log(EventCode::INACTIVE_MEAL, w.studentId, w.hall->getHallId(), date, meal->getMealType());
+            return SeatResult::SKIPPED;
+        }
+        price = item->price;
+    }
+    storage.reserveHistory(*student, 1, 1);
+
+    thread_local vector<Reservation> items(1);
+    items[0] = Reservation(IDGenerator::generateReservationId(), w.hall, meal);
+    items[0].setDate(date);
+    WalRecord records[2];
+    Reservation* booked = nullptr;
+    uint64_t lsn;
+    {
+        shared_lock<shared_mutex> gate(storage.getCommitGate());
+        Transaction t = BalanceLedger::debit(*student, price);
+        if (t.getStatus() != TransactionStatus::COMPLETED) {
+            gate.unlock();
+            EventLog::instance().log(EventCode::INSUFFICIENT_BALANCE, w.studentId, w.hall->getHallId(), date,
+                                     meal->getMealType());
+            return SeatResult::SKIPPED;
+        }
+        records[0] = WalRecord::transaction(w.studentId, t);
+        storage.addTransaction(*student, move(t));
+        storage.addReservations(items, w.studentId, [&](Reservation& r) {
+            r.setStatus(RStatus::SUCCESS);
+            student->addReservation(&r);
+            booked = &r;
+            records[1] = WalRecord::reservation(w.studentId, r);
+        });
+        lsn = WriteAheadLog::instance().append(records, 2);
+    }
+    if (!lsn || WriteAheadLog::instance().waitDurable(lsn)) return SeatResult::SEATED;
+
+    {
+        shared_lock<shared_mutex> gate(storage.getCommitGate());
+        student->revokeReservation(booked);
+        Transaction refund = BalanceLedger::credit(*student, price);
+        records[0] = WalRecord::cancellation(w.studentId, booked->getReservationId());
+        records[1] = WalRecord::transaction(w.studentId, refund);
+        storage.addTransaction(*student, move(refund));
+        WriteAheadLog::instance().append(records, 2);
+    }
+    EventLog::instance().log(EventCode::NOT_DURABLE, w.studentId, w.hall->getHallId(), date, meal->getMealType());
+    return SeatResult::NOT_DURABLE;
+}
+
+// The claimed seat passes down the queue until someone can take and pay for it; if nobody can, it goes back.
+// When the log fails the waiter keeps their place and the seat goes back too, rather than being offered on
+// to waiters who cannot be logged either.
+void WaitlistEngine::promote(uint64_t k) {
+    Shard& s = shardFor(k);
+    Waiter w;
+    bool found;
+    {
+        lock_guard<mutex> guard(s.lock);
+        Queue& q = s.queues[k];
+        --q.claimedSeats;
+        found = popLocked(q, w);
+    }
+    SeatResult result = SeatResult::SKIPPED;
+    while (found && (result = seat(w)) == SeatResult::SKIPPED) {
+        lock_guard<mutex> guard(s.lock);
+        found = popLocked(s.queues[k], w);
+    }
+    {
+        lock_guard<mutex> guard(s.lock);
+        Queue& q = s.queues[k];
+        if (result == SeatResult::NOT_DURABLE && !q.members.count(w.studentId)) pushLocked(q, w);
+        if (q.members.empty() && !q.claimedSeats) s.queues.erase(k);
+    }
+    if (!found || result == SeatResult::NOT_DURABLE)
+        Storage::instance().releaseSeat(static_cast<int>(k >> 24), DateTime(static_cast<uint32_t>(k >> 2 & 0x3fffff), 0),
+                                        static_cast<MealType>(k & 3));
+}
+
 class SessionBase {
     protected:
         time_t createdAt;
@@ -366,232 +4406,2100 @@ class SessionBase {
 
     namespace StudentSession {
 
-        class SessionManager : public SessionBase {
+        class Session : public SessionBase {
             Student* currentStudent;
-            ShoppingCart* shoppingCart;
+            Admin* currentStaff;
+            ShoppingCart shoppingCart;
             int studentID;
-        
-            SessionManager()
-                : currentStudent(nullptr), shoppingCart(new ShoppingCart()), studentID(0) {}
-        
-            SessionManager(const SessionManager&) = delete;
-            SessionManager& operator=(const SessionManager&) = delete;
-        
+            uint64_t token;
+            atomic<int64_t> lastActive;
+            mutex lock;
+
         public:
-            static SessionManager& instance() {
-                static SessionManager sessionInstance;
-                return sessionInstance;
+            static int64_t clockSeconds() {
+                return chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now().time_since_epoch()).count();
             }
-        
+
+            explicit Session(uint64_t t = 0)
+                : currentStudent(nullptr), currentStaff(nullptr), studentID(0), token(t), lastActive(clockSeconds()) {}
+
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
             void loadSession() override {}
             void saveSession() override {}
             void login(const string& username, const string& password) override {}
             void logout() override {
                 currentStudent = nullptr;
+                currentStaff = nullptr;
                 studentID = 0;
                 status = SessionStatus::ANONYMOUS;
+                shoppingCart.clear();
+            }
+
+            void attach(Student* s) {
+                currentStudent = s;
+                currentStaff = nullptr;
+                studentID = s ? s->getUserId() : 0;
+                status = s ? SessionStatus::AUTHENTICATED : SessionStatus::ANONYMOUS;
+                lastLoginTime = time(0);
+            }
+            // A staff session carries no student and no cart.
+            void attachStaff(Admin* a) {
+                logout();
+                currentStaff = a;
+                status = a ? SessionStatus::AUTHENTICATED : SessionStatus::ANONYMOUS;
+                lastLoginTime = time(0);
             }
-        
+
+            void touch() { lastActive.store(clockSeconds(), memory_order_relaxed); }
+            int64_t getLastActive() const { return lastActive.load(memory_order_relaxed); }
+            mutex& getLock() { return lock; }
+
             Student* getCurrentStudent() const { return currentStudent; }
-            ShoppingCart* getShoppingCart() const { return shoppingCart; }
+            Admin* getCurrentStaff() const { return currentStaff; }
+            ShoppingCart* getShoppingCart() { return &shoppingCart; }
             int getStudentID() const { return studentID; }
-        
+            uint64_t getToken() const { return token; }
+
             void setCurrentStudent(Student* s) { currentStudent = s; }
             void setStudentID(int id) { studentID = id; }
         };
-        
+
+        class SessionManager : public Session {
+            SessionManager() {}
+
+        public:
+            static SessionManager& instance() {
+                static SessionManager sessionInstance;
+                return sessionInstance;
+            }
+        };
+
+        // Sessions keyed by random tokens, spread over shards so opening and finding them rarely contend. A token's
+        // low bits name its shard. Sessions idle for too long are dropped by expireIdle, which the optional reaper
+        // thread calls on a timer; one still in use by withSession stays alive until that call returns.
+        class SessionTable {
+            static constexpr size_t kShards = 64;
+
+            struct alignas(64) Shard {
+                mutex lock;
+                unordered_map<uint64_t, shared_ptr<Session>> sessions;
+                mt19937_64 tokens;
+            };
+
+            Shard shards[kShards];
+            atomic<size_t> nextShard;
+            thread reaper;
+            mutex reaperLock;
+            condition_variable reaperWake;
+            bool reaperStopping;
+
+            Shard& shardFor(uint64_t token) { return shards[token % kShards]; }
+
+        public:
+            SessionTable() : nextShard(0), reaperStopping(false) {
+                random_device seed;
+                for (auto& shard : shards) shard.tokens.seed((uint64_t(seed()) << 32) | seed());
+            }
+            ~SessionTable() { stopReaper(); }
+
+            SessionTable(const SessionTable&) = delete;
+            SessionTable& operator=(const SessionTable&) = delete;
+
+            uint64_t open(Student* student) {
+                size_t home = nextShard.fetch_add(1, memory_order_relaxed) % kShards;
+                Shard& shard = shards[home];
+                lock_guard<mutex> guard(shard.lock);
+                uint64_t token;
+                do {
+                    token = (shard.tokens() / kShards) * kShards + home;
+                } while (token == 0 || shard.sessions.count(token));
+                auto session = make_shared<Session>(token);
+                session->attach(student);
+                shard.sessions.emplace(token, move(session));
+                return token;
+            }
+
+            shared_ptr<Session> find(uint64_t token) {
+                Shard& shard = shardFor(token);
+                lock_guard<mutex> guard(shard.lock);
+                auto it = shard.sessions.find(token);
+                return it == shard.sessions.end() ? nullptr : it->second;
+            }
+
+            bool close(uint64_t token) {
+                Shard& shard = shardFor(token);
+                lock_guard<mutex> guard(shard.lock);
+                return shard.sessions.erase(token) > 0;
+            }
+
+            // Runs action on the session with its lock held; false if the token is unknown or has expired.
+            template <typename F>
+            bool withSession(uint64_t token, F&& action) {
+                shared_ptr<Session> session = find(token);
+                if (!session) return false;
+                lock_guard<mutex> guard(session->getLock());
+                session->touch();
+                action(*session);
+                return true;
+            }
+
+            size_t expireIdle(int64_t maxIdleSeconds) {
+                int64_t cutoff = Session::clockSeconds() - maxIdleSeconds;
+                size_t expired = 0;
+                for (auto& shard : shards) {
+                    lock_guard<mutex> guard(shard.lock);
+                    for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+                        if (it->second->getLastActive() < cutoff) {
+                            it = shard.sessions.erase(it);
+                            ++expired;
+                        } else {
+                            ++it;
+                        }
+                    }
+                }
+                return expired;
+            }
+
+            size_t size() {
+                size_t total = 0;
+                for (auto& shard : shards) {
+                    lock_guard<mutex> guard(shard.lock);
+                    total += shard.sessions.size();
+                }
+                return total;
+            }
+
+            void startReaper(int64_t maxIdleSeconds, int periodSeconds) {
+                stopReaper();
+                reaperStopping = false;
+                reaper = thread([this, maxIdleSeconds, periodSeconds] {
+                    unique_lock<mutex> guard(reaperLock);
+                    while (!reaperWake.wait_for(guard, chrono::seconds(periodSeconds), [this] { return reaperStopping; })) {
+                        guard.unlock();
+                        expireIdle(maxIdleSeconds);
+                        guard.lock();
+                    }
+                });
+            }
+
+            void stopReaper() {
+                if (!reaper.joinable()) return;
+                {
+                    lock_guard<mutex> guard(reaperLock);
+                    reaperStopping = true;
+                }
+                reaperWake.notify_all();
+                reaper.join();
+            }
+        };
+
+        }
+
+
+// DateTime::format redoes the civil-date conversion on every call; a view prints many stamps from the same few days.
+// Each Renderer owns one, so there is no shared state to guard.
+class TimeFormatter {
+    uint32_t day;
+    char date[10];
+
+public:
+    TimeFormatter() : day(UINT32_MAX) {}
+
+    char* format(DateTime t, char* out) {
+        if (t.getDay() != day) {
+            char full[DateTime::kFormattedSize];
+            t.format(full);
+            memcpy(date, full, sizeof(date));
+            day = t.getDay();
+        }
+        memcpy(out, date, sizeof(date));
+        unsigned hh = t.getMinute() / 60, mm = t.getMinute() % 60;
+        out[10] = ' ';
+        out[11] = static_cast<char>('0' + hh / 10);
+        out[12] = static_cast<char>('0' + hh % 10);
+        out[13] = ':';
+        out[14] = static_cast<char>('0' + mm / 10);
+        out[15] = static_cast<char>('0' + mm % 10);
+        return out + DateTime::kFormattedSize;
+    }
+};
+
+// Formats Panel responses into a reusable buffer, as plain text or one compact JSON object per response,
+// and hands each response to the stream in a single write.
+class Renderer {
+    string buf;
+    OutputMode mode;
+    bool firstItem;
+    TimeFormatter clock;
+
+    void raw(string_view s) { buf.append(s.data(), s.size()); }
+    void raw(char c) { buf.push_back(c); }
+
+    void number(int64_t v) {
+        char tmp[24];
+        raw(string_view(tmp, static_cast<size_t>(to_chars(tmp, tmp + sizeof(tmp), v).ptr - tmp)));
+    }
+    void money(Money m) {
+        char tmp[Money::kMaxFormattedSize];
+        raw(string_view(tmp, static_cast<size_t>(m.format(tmp) - tmp)));
+    }
+    void time(DateTime t, size_t width = DateTime::kFormattedSize) {
+        char tmp[DateTime::kFormattedSize];
+        clock.format(t, tmp);
+        raw(string_view(tmp, width));
+    }
+    void jsonString(string_view s) {
+        static const char hex[] = "0123456789abcdef";
+        raw('"');
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                raw('\\');
+                raw(c);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                raw("\\u00");
+                raw(hex[c >> 4]);
+                raw(hex[c & 15]);
+            } else {
+                raw(c);
+            }
+        }
+        raw('"');
+    }
+    void key(string_view k, bool first = false) {
+        if (!first) raw(',');
+        jsonString(k);
+        raw(':');
+    }
+    void item() {
+        if (!firstItem) raw(',');
+        firstItem = false;
+        raw('{');
+    }
+    void quotedTime(DateTime t, size_t width = DateTime::kFormattedSize) {
+        raw('"');
+        time(t, width);
+        raw('"');
+    }
+
+    static string_view statusName(RStatus s) {
+        switch (s) {
+            case RStatus::SUCCESS: return "Success";
+            case RStatus::CANCELLED: return "Cancelled";
+            case RStatus::FAILED: return "Failed";
+            case RStatus::NOT_PAID: return "Not Paid";
+            case RStatus::CHECKED_IN: return "Checked In";
+        }
+        return "";
+    }
+    static string_view statusName(TransactionStatus s) {
+        switch (s) {
+            case TransactionStatus::PENDING: return "Pending";
+            case TransactionStatus::COMPLETED: return "Completed";
+            case TransactionStatus::FAILED: return "Failed";
+        }
+        return "";
+    }
+    static string_view typeName(TransactionType t) { return t == TransactionType::PAYMENT ? "Payment" : "Transfer"; }
+    static string_view mealName(MealType t) {
+        switch (t) {
+            case MealType::BREAKFAST: return "Breakfast";
+            case MealType::LUNCH: return "Lunch";
+            case MealType::DINNER: return "Dinner";
+        }
+        return "";
+    }
+
+public:
+    explicit Renderer(OutputMode m = OutputMode::TEXT) : mode(m), firstItem(true) {}
+
+    OutputMode getMode() const { return mode; }
+    void setMode(OutputMode m) { mode = m; }
+    const string& data() const { return buf; }
+    void clear() { buf.clear(); }
+
+    void emit(ostream& out) {
+        out.write(buf.data(), static_cast<streamsize>(buf.size()));
+        out.flush();
+        buf.clear();
+    }
+
+    void message(string_view text) {
+        if (mode == OutputMode::TEXT) {
+            raw(text);
+            raw('\n');
+            return;
+        }
+        raw("{\"message\":");
+        jsonString(text);
+        raw("}\n");
+    }
+    void error(string_view text) {
+        if (mode == OutputMode::TEXT) {
+            raw(text);
+            raw('\n');
+            return;
+        }
+        raw("{\"error\":");
+        jsonString(text);
+        raw("}\n");
+    }
+
+    void balance(Money m) {
+        raw(mode == OutputMode::TEXT ? "Balance: " : "{\"balance\":");
+        money(m);
+        raw(mode == OutputMode::TEXT ? "\n" : "}\n");
+    }
+
+    void student(const Student& s) {
+        if (mode == OutputMode::TEXT) {
+            raw("Student Info:\nUser ID: ");
+            number(s.getUserId());
+            raw("\nStudent ID: ");
+            raw(s.getStudentId());
+            raw("\nName: ");
+            raw(s.getName());
+            raw(' ');
+            raw(s.getLastName());
+            raw("\nEmail: ");
+            raw(s.getEmail());
+            raw("\nPhone: ");
+            raw(s.getPhone());
+            raw("\nAccount: ");
+            money(s.getAccountBalance());
+            raw(s.getIsActive() ? "\nActive: Yes\n" : "\nActive: No\n");
+            return;
+        }
+        raw("{\"student\":{");
+        key("userId", true);
+        number(s.getUserId());
+        key("studentId");
+        jsonString(s.getStudentId());
+        key("name");
+        jsonString(s.getName());
+        key("lastName");
+        jsonString(s.getLastName());
+        key("email");
+        jsonString(s.getEmail());
+        key("phone");
+        jsonString(s.getPhone());
+        key("balance");
+        money(s.getAccountBalance());
+        key("active");
+        raw(s.getIsActive() ? "true" : "false");
+        raw("}}\n");
+    }
+
+    // A list is a titled block in text mode and {"<name>":[...]} in JSON mode.
+    void beginList(string_view name, string_view title) {
+        firstItem = true;
+        if (mode == OutputMode::TEXT) {
+            if (!title.empty()) {
+                raw(title);
+                raw('\n');
+            }
+            return;
+        }
+        raw('{');
+        jsonString(name);
+        raw(":[");
+    }
+    void endList() {
+        if (mode == OutputMode::JSON) raw("]}\n");
+    }
+
+    void reservation(const Reservation& r) {
+        if (mode == OutputMode::TEXT) {
+            raw("Reservation ID: ");
+            number(static_cast<int64_t>(r.getReservationId()));
+            raw("\nStatus: ");
+            raw(statusName(r.getStatus()));
+            raw("\nCreated At: ");
+            time(r.getCreatedAt());
+            raw("\nDate: ");
+            time(r.getDate());
+            raw("\n-----------------------\n");
+            return;
+        }
+        item();
+        key("id", true);
+        number(static_cast<int64_t>(r.getReservationId()));
+        key("status");
+        jsonString(statusName(r.getStatus()));
+        key("mealId");
+        number(r.getMeal() ? r.getMeal()->getMealId() : 0);
+        key("hallId");
+        number(r.getDiningHall() ? r.getDiningHall()->getHallId() : 0);
+        key("createdAt");
+        quotedTime(r.getCreatedAt());
+        key("date");
+        quotedTime(r.getDate());
+        raw('}');
+    }
+
+    void menuItem(const MenuCatalog::Item& m) {
+        if (mode == OutputMode::TEXT) {
+            raw("Meal ID: ");
+            number(m.mealId);
+            raw(", Name: ");
+            raw(m.meal->getName());
+            raw(", Price: ");
+            money(m.price);
+            for (size_t i = 0; i < m.meal->getSideItemCount(); ++i) {
+                raw(i ? ", " : ", Sides: ");
+                raw(m.meal->getSideItem(i));
+            }
+            raw('\n');
+            return;
+        }
+        item();
+        key("id", true);
+        number(m.mealId);
+        key("name");
+        jsonString(m.meal->getName());
+        key("price");
+        money(m.price);
+        key("sides");
+        raw('[');
+        for (size_t i = 0; i < m.meal->getSideItemCount(); ++i) {
+            if (i) raw(',');
+            jsonString(m.meal->getSideItem(i));
+        }
+        raw("]}");
+    }
+
+    void ticket(const ReservationIndex::Entry& e) {
+        const Reservation& r = *e.reservation;
+        if (mode == OutputMode::TEXT) {
+            raw("Reservation ID: ");
+            number(static_cast<int64_t>(e.id));
+            raw("\nStudent ID: ");
+            number(e.studentId);
+            raw("\nHall ID: ");
+            number(e.hallId);
+            raw("\nStatus: ");
+            raw(statusName(r.getStatus()));
+            raw("\nDate: ");
+            time(r.getDate());
+            raw('\n');
+            return;
+        }
+        raw("{\"ticket\":{");
+        key("id", true);
+        number(static_cast<int64_t>(e.id));
+        key("studentId");
+        number(e.studentId);
+        key("hallId");
+        number(e.hallId);
+        key("mealId");
+        number(r.getMeal() ? r.getMeal()->getMealId() : 0);
+        key("status");
+        jsonString(statusName(r.getStatus()));
+        key("date");
+        quotedTime(r.getDate());
+        raw("}}\n");
+    }
+
+    void transaction(const Transaction& t) {
+        if (mode == OutputMode::TEXT) {
+            raw("ID: ");
+            number(static_cast<int64_t>(t.getTransactionID()));
+            raw(", Amount: ");
+            money(t.getAmount());
+            raw(", Type: ");
+            raw(typeName(t.getType()));
+            raw(", Status: ");
+            raw(statusName(t.getStatus()));
+            raw(", Date: ");
+            time(t.getCreatedAt());
+            raw('\n');
+            return;
+        }
+        item();
+        key("id", true);
+        number(static_cast<int64_t>(t.getTransactionID()));
+        key("amount");
+        money(t.getAmount());
+        key("type");
+        jsonString(typeName(t.getType()));
+        key("status");
+        jsonString(statusName(t.getStatus()));
+        key("createdAt");
+        quotedTime(t.getCreatedAt());
+        raw('}');
+    }
+
+    void event(const EventLog::Record& e) {
+        if (mode == OutputMode::TEXT) {
+            raw(EventLog::codeName(e.code));
+            raw(" hall=");
+            number(e.hallId);
+            raw(" date=");
+            time(DateTime::fromPacked(e.date), 10);
+            raw(" meal=");
+            raw(mealName(static_cast<MealType>(e.mealType)));
+            raw('\n');
+            return;
+        }
+        item();
+        key("code", true);
+        jsonString(EventLog::codeName(e.code));
+        key("hallId");
+        number(e.hallId);
+        key("date");
+        quotedTime(DateTime::fromPacked(e.date), 10);
+        key("meal");
+        jsonString(mealName(static_cast<MealType>(e.mealType)));
+        raw('}');
+    }
+};
+
+class Panel {
+        StudentSession::Session* session;
+        Renderer view;
+        ostream* out;
+
+        static constexpr size_t kRecentShown = 10;
+        static constexpr size_t kPageSize = 20;
+        static constexpr const char* kNotDurable = "Applied, but the change could not be saved to disk.";
+
+        // Without a stream, responses accumulate in the view until the owner drains them.
+        void respond() {
+            if (out) view.emit(*out);
+        }
+        void reply(string_view text) {
+            view.message(text);
+            respond();
+        }
+        void fail(string_view text) {
+            view.error(text);
+            respond();
+        }
+        void prompt(const char* text) {
+            if (out) *out << text << flush;
+        }
+
+    public:
+        Panel() : session(&StudentSession::SessionManager::instance()), out(&cout) {}
+        explicit Panel(StudentSession::Session& s, OutputMode mode = OutputMode::TEXT, ostream* sink = &cout)
+            : session(&s), view(mode), out(sink) {}
+        // Serves whichever session bind() names last; front ends that look sessions up per request use this.
+        Panel(OutputMode mode, ostream* sink) : session(nullptr), view(mode), out(sink) {}
+
+        void bind(StudentSession::Session& s) { session = &s; }
+
+        Renderer& getView() { return view; }
+
+        void Action(int action) {
+            switch (action) {
+                case 1: showStudentInfo(); break;
+                case 2: checkBalance(); break;
+                case 3: viewReservations(); break;
+                case 4: viewShoppingCart(); break;
+                case 5: addToShoppingCart(); break;
+                case 6: confirmShoppingCart(); break;
+                case 7: removeShoppingCartItem(); break;
+                case 8: increaseBalance(); break;
+                case 9: viewRecentTransactions(); break;
+                case 10: cancelReservation(); break;
+                case 11: viewTransactionHistory(); break;
+                case 12: viewRecentErrors(); break;
+                case 13: findReservation(); break;
+                case 14: checkIn(); break;
+                case 15: joinWaitlist(); break;
+                case 16: viewMenu(); break;
+                case 17: leaveWaitlist(); break;
+                case 0: exit(); break;
+                default: fail("Invalid action.");
+            }
+            WaitlistEngine::instance().promotePending();
+        }
+    
+        void showMenu() {
+            if (!out) return;
+            *out << "1. Show Info\n2. Check Balance\n3. View Reservations\n4. View Shopping Cart\n"
+                 << "5. Add to Shopping Cart\n6. Confirm Shopping Cart\n7. Remove Cart Item\n"
+                 << "8. Increase Balance\n9. View Transactions\n10. Cancel Reservation\n11. View Older Transactions\n12. View Recent Errors\n13. Find Reservation\n14. Check In\n15. Join Waitlist\n16. View Menu\n17. Leave Waitlist\n0. Exit\n";
+            out->flush();
+        }
+
+        void login(int userId, const string& password) {
+            Student* student = Storage::instance().findStudent(userId);
+            if (!student || student->getHashedPassword() != password) return fail("Invalid credentials.");
+            session->attach(student);
+            reply("Logged in.");
+        }
+
+        void staffLogin(int userId, const string& password) {
+            Admin* staff = Storage::instance().findStaff(userId);
+            if (!staff || staff->getHashedPassword() != password) return fail("Invalid credentials.");
+            session->attachStaff(staff);
+            reply("Logged in.");
+        }
+
+        void logout() {
+            session->logout();
+            reply("Logged out.");
+        }
+
+        void invalidRequest() { fail("Invalid request."); }
+        // What a reply deferred by WriteAheadLog::awaitDurable becomes when the batch could not be saved.
+        void notDurable() { fail(kNotDurable); }
+    
+        void showStudentInfo() {
+            StudentSession::Session& sm = *session;
+            if (!sm.getCurrentStudent()) return fail("No student logged in.");
+            view.student(*sm.getCurrentStudent());
+            respond();
+        }
+    
+        void checkBalance() {
+            StudentSession::Session& sm = *session;
+            if (!sm.getCurrentStudent()) return fail("No student logged in.");
+            view.balance(sm.getCurrentStudent()->getAccountBalance());
+            respond();
+        }
+    
+        void viewReservations() {
+            StudentSession::Session& sm = *session;
+            if (!sm.getCurrentStudent()) return fail("No student logged in.");
+            view.beginList("reservations", "");
+            for (auto* r : sm.getCurrentStudent()->getReserves()) view.reservation(*r);
+            view.endList();
+            respond();
+        }
+    
+        void viewShoppingCart() {
+            StudentSession::Session& sm = *session;
+            view.beginList("cart", "Shopping Cart Items:");
+            for (const auto& r : sm.getShoppingCart()->getReservations()) view.reservation(r);
+            view.endList();
+            respond();
+        }
+    
+        void addToShoppingCart() {
+            int mealId = 0, hallId = 0;
+            prompt("Enter Meal ID to add to cart: ");
+            cin >> mealId;
+            prompt("Enter Dining Hall ID: ");
+            cin >> hallId;
+            addToShoppingCart(mealId, hallId);
+        }
+
+        void addToShoppingCart(int mealId, int hallId) {
+            StudentSession::Session& sm = *session;
+    
+            MenuCatalog::Reader menu;
+            const MenuCatalog::Item* selected = menu->find(mealId);
+    
+            if (!selected || !selected->active) return fail("Invalid meal ID or inactive meal.");
+    
+            DiningHall* selectedHall = Storage::instance().findDiningHall(hallId);
+    
+            if (!selectedHall) return fail("Invalid dining hall ID.");
+    
+            Reservation newRes;
+            newRes.setReservationId(IDGenerator::generateReservationId());
+            newRes.setMeal(selected->meal);
+            newRes.setDiningHall(selectedHall);
+            newRes.setStatus(RStatus::NOT_PAID);
+    
+            sm.getShoppingCart()->addReservation(newRes);
+            reply("Reservation added to cart.");
+        }
+    
+        void confirmShoppingCart() {
+            StudentSession::Session& sm = *session;
+            Student* student = sm.getCurrentStudent();
+            if (!student) return fail("No student logged in.");
+
+            switch (CheckoutEngine::commit(*student, *sm.getShoppingCart())) {
+                case CheckoutStatus::CONFIRMED: reply("Reservation(s) confirmed."); break;
+                case CheckoutStatus::EMPTY_CART: fail("Shopping cart is empty."); break;
+                case CheckoutStatus::INACTIVE_MEAL: fail("Cart contains an inactive meal."); break;
+                case CheckoutStatus::ALREADY_RESERVED: fail("Already reserved for this meal type on that day."); break;
+                case CheckoutStatus::HALL_FULL: fail("Dining hall is full. Join its waitlist to get the next free seat."); break;
+                case CheckoutStatus::INSUFFICIENT_BALANCE: fail("Insufficient balance."); break;
+                case CheckoutStatus::NOT_DURABLE: fail(kNotDurable); break;
+            }
+        }
+
+    void removeShoppingCartItem() {
+        uint64_t id = 0;
+        prompt("Enter Reservation ID to remove: ");
+        cin >> id;
+        removeShoppingCartItem(id);
+    }
+
+    void removeShoppingCartItem(uint64_t id) {
+        StudentSession::Session& sm = *session;
+        sm.getShoppingCart()->removeReservation(id);
+        reply("Removed from cart.");
+    }
+
+    void increaseBalance() {
+        string input;
+        prompt("Enter amount to add: ");
+        cin >> input;
+        increaseBalance(input);
+    }
+
+    void increaseBalance(string_view input) {
+        StudentSession::Session& sm = *session;
+        Student* student = sm.getCurrentStudent();
+        Money amount;
+        if (!student || !Money::parse(input.data(), input.size(), amount) || !amount.isPositive()) return fail("Invalid amount.");
+
+        uint64_t lsn;
+        {
+            shared_lock<shared_mutex> gate(Storage::instance().getCommitGate());
+            Transaction t = BalanceLedger::credit(*student, amount);
+            if (t.getStatus() != TransactionStatus::COMPLETED) {
+                gate.unlock();
+                return fail("Invalid amount.");
+            }
+            WalRecord record = WalRecord::transaction(student->getUserId(), t);
+            Storage::instance().addTransaction(*student, move(t));
+            lsn = WriteAheadLog::instance().append(&record, 1);
+        }
+        if (lsn && !WriteAheadLog::instance().awaitDurable(lsn)) return fail(kNotDurable);
+        reply("Balance increased.");
+    }
+
+    void viewRecentTransactions() {
+        StudentSession::Session& sm = *session;
+        if (!sm.getCurrentStudent()) return fail("No student logged in.");
+        view.beginList("transactions", "Recent Transactions:");
+        sm.getCurrentStudent()->getTransactions().forEachRecent(kRecentShown, [&](const Transaction& t) { view.transaction(t); });
+        view.endList();
+        respond();
+    }
+
+    void viewTransactionHistory() {
+        size_t pageNo = 0;
+        prompt("Enter page (0 = newest archived): ");
+        cin >> pageNo;
+        viewTransactionHistory(pageNo);
+    }
+
+    void viewTransactionHistory(size_t pageNo) {
+        StudentSession::Session& sm = *session;
+        Student* student = sm.getCurrentStudent();
+        thread_local vector<Transaction> page;
+        if (!student || !HistoryArchive::instance().page(student->getUserId(), pageNo, kPageSize, page) || page.empty())
+            return fail("No archived transactions on that page.");
+        view.beginList("transactions", "");
+        for (const auto& t : page) view.transaction(t);
+        view.endList();
+        respond();
+    }
+
+    void viewRecentErrors() {
+        StudentSession::Session& sm = *session;
+        Student* student = sm.getCurrentStudent();
+        if (!student) return fail("No student logged in.");
+        thread_local vector<EventLog::Record> errors;
+        EventLog::instance().recentErrors(student->getUserId(), errors);
+        if (errors.empty() && view.getMode() == OutputMode::TEXT) return reply("No recent errors.");
+        view.beginList("errors", "");
+        for (const auto& e : errors) view.event(e);
+        view.endList();
+        respond();
+    }
+
+    void cancelReservation() {
+        uint64_t id = 0;
+        prompt("Enter Reservation ID to cancel: ");
+        cin >> id;
+        cancelReservation(id);
+    }
+
+    void cancelReservation(uint64_t id) {
+        StudentSession::Session& sm = *session;
+        if (!sm.getCurrentStudent()) return fail("No student logged in.");
+        switch (ReservationDesk::cancel(*sm.getCurrentStudent(), id)) {
+            case TicketStatus::OK: break;
+            case TicketStatus::NOT_DURABLE: return fail(kNotDurable);
+            default: return fail("Reservation not found or not cancellable.");
+        }
+        reply("Reservation cancelled.");
+    }
+
+    void joinWaitlist() {
+        int mealId = 0, hallId = 0;
+        prompt("Enter Meal ID: ");
+        cin >> mealId;
+        prompt("Enter Dining Hall ID: ");
+        cin >> hallId;
+        joinWaitlist(mealId, hallId);
+    }
+
+    void joinWaitlist(int mealId, int hallId) {
+        Student* student = session->getCurrentStudent();
+        if (!student) return fail("No student logged in.");
+        MenuCatalog::Reader menu;
+        const MenuCatalog::Item* item = menu->find(mealId);
+        if (!item || !item->active) return fail("Invalid meal ID or inactive meal.");
+        Meal* meal = item->meal;
+        DiningHall* hall = Storage::instance().findDiningHall(hallId);
+        if (!hall) return fail("Invalid dining hall ID.");
+        if (student->hasActiveReservationFor(DateTime::nextOccurrence(meal->getReserveDay(), DateTime::now()),
+                                             meal->getMealType()))
+            return fail("Already reserved for this meal type on that day.");
+        size_t length = WaitlistEngine::instance().join(student->getUserId(), meal, hall);
+        if (!length) return fail("Already on the waitlist for this meal.");
+        char text[64];
+        snprintf(text, sizeof(text), "Joined the waitlist (%zu waiting).", length);
+        reply(text);
+    }
+
+    void leaveWaitlist() {
+        int mealId = 0, hallId = 0;
+        prompt("Enter Meal ID: ");
+        cin >> mealId;
+        prompt("Enter Dining Hall ID: ");
+        cin >> hallId;
+        leaveWaitlist(mealId, hallId);
+    }
+
+    void leaveWaitlist(int mealId, int hallId) {
+        Student* student = session->getCurrentStudent();
+        if (!student) return fail("No student logged in.");
+        Meal* meal = Storage::instance().findMeal(mealId);
+        if (!meal) return fail("Invalid meal ID.");
+        DiningHall* hall = Storage::instance().findDiningHall(hallId);
+        if (!hall) return fail("Invalid dining hall ID.");
+        if (!WaitlistEngine::instance().withdraw(student->getUserId(), meal, hall))
+            return fail("Not on the waitlist for this meal.");
+        reply("Left the waitlist.");
+    }
+
+    void viewMenu() {
+        int day = 0, type = 0;
+        prompt("Enter Day (0 = Saturday ... 4 = Wednesday): ");
+        cin >> day;
+        prompt("Enter Meal Type (0 = Breakfast, 1 = Lunch, 2 = Dinner): ");
+        cin >> type;
+        string side;
+        prompt("Only meals with side item (- for all): ");
+        cin >> side;
+        viewMenu(day, type, side == "-" ? string_view() : string_view(side));
+    }
+
+    // With a side item, only meals serving it are listed; a side no meal has ever had matches nothing.
+    void viewMenu(int day, int type, string_view side = string_view()) {
+        if (day < 0 || day > 4 || type < 0 || type > 2) return fail("Invalid day or meal type.");
+        uint32_t sideId = StringTable::kEmpty;
+        bool known = side.empty() || StringTable::instance().find(side, sideId);
+        MenuCatalog::Reader menu;
+        auto range = menu->slot(static_cast<ReserveDay>(day), static_cast<MealType>(type));
+        view.beginList("menu", "Menu:");
+        for (const MenuCatalog::Item* m = range.first; known && m != range.second; ++m)
+            if (m->active && (side.empty() || m->meal->hasSideItem(sideId))) view.menuItem(*m);
+        view.endList();
+        respond();
+    }
+
+    void findReservation() {
+        uint64_t id = 0;
+        prompt("Enter Reservation ID: ");
+        cin >> id;
+        findReservation(id);
+    }
+
+    void findReservation(uint64_t id) {
+        if (!session->getCurrentStaff()) return fail("Staff login required.");
+        ReservationIndex::Entry e;
+        if (!ReservationDesk::lookup(id, e)) return fail("Reservation not found.");
+        view.ticket(e);
+        respond();
+    }
+
+    void checkIn() {
+        uint64_t id = 0;
+        int hallId = 0;
+        prompt("Enter Reservation ID: ");
+        cin >> id;
+        prompt("Enter Dining Hall ID: ");
+        cin >> hallId;
+        checkIn(id, hallId);
+    }
+
+    void checkIn(uint64_t id, int hallId) {
+        if (!session->getCurrentStaff()) return fail("Staff login required.");
+        switch (ReservationDesk::checkIn(id, hallId, DateTime::now())) {
+            case TicketStatus::OK: reply("Checked in."); break;
+            case TicketStatus::NOT_FOUND: fail("Reservation not found."); break;
+            case TicketStatus::NOT_OWNER: fail("Reservation belongs to another student."); break;
+            case TicketStatus::WRONG_HALL: fail("Reservation is for another dining hall."); break;
+            case TicketStatus::WRONG_DAY: fail("Reservation is not for today."); break;
+            case TicketStatus::NOT_ACTIVE: fail("Reservation is cancelled or already used."); break;
+            case TicketStatus::NOT_DURABLE: fail(kNotDurable); break;
+        }
+    }
+
+    void exit() {
+        reply("Goodbye!");
+    }
+};
+
+// Line protocol: one request per line, "<VERB> [args]", answered by exactly one JSON line, in order, so clients
+// may pipeline. Verbs: LOGIN <userId> <password>, STAFF <staffId> <password>, LOGOUT, INFO, BALANCE, RESERVATIONS,
+// CART, ADD <mealId> <hallId>, REMOVE <reservationId>, CONFIRM, TOPUP <amount>, TRANSACTIONS, HISTORY <page>, ERRORS,
+// CANCEL <reservationId>, WAIT <mealId> <hallId>, UNWAIT <mealId> <hallId>, MENU <day> <mealType> [sideItem],
+// LOOKUP <reservationId>, CHECKIN <reservationId> <hallId>, QUIT.
+// MENU needs no login; LOOKUP and CHECKIN need a session logged in with STAFF.
+class Server {
+    static constexpr size_t kMaxLine = 4096;
+    static constexpr size_t kReadChunk = 64 * 1024;
+    static constexpr size_t kMaxPendingOutput = 1 << 20;
+    static constexpr int kMaxEvents = 64;
+
+    struct Connection {
+        int fd;
+        uint64_t token;
+        Panel panel;
+        string in;
+        string out;
+        size_t outOffset;
+        uint32_t interest;
+        bool closing;
+
+        Connection(int f, uint64_t t)
+            : fd(f), token(t), panel(OutputMode::JSON, nullptr), outOffset(0), interest(EPOLLIN), closing(false) {}
+    };
+
+    struct Reactor {
+        int epfd = -1;
+        int wakeFd = -1;
+        thread worker;
+        mutex inboxLock;
+        vector<int> inbox;
+        unordered_map<int, unique_ptr<Connection>> connections;
+    };
+
+    vector<unique_ptr<Reactor>> reactors;
+    StudentSession::SessionTable sessions;
+    int listenFd;
+    bool unixSocket;
+    uint16_t port;
+    atomic<bool> stopping;
+    atomic<size_t> nextReactor;
+    char listenTag;
+
+    template <typename T>
+    static bool nextNumber(string_view& rest, T& out) {
+        string_view token = nextToken(rest);
+        auto r = from_chars(token.data(), token.data() + token.size(), out);
+        return !token.empty() && r.ec == errc() && r.ptr == token.data() + token.size();
+    }
+    static string_view nextToken(string_view& rest) {
+        size_t begin = rest.find_first_not_of(' ');
+        if (begin == string_view::npos) {
+            rest = {};
+            return {};
         }
+        size_t end = rest.find(' ', begin);
+        string_view token = rest.substr(begin, end == string_view::npos ? string_view::npos : end - begin);
+        rest = end == string_view::npos ? string_view() : rest.substr(end);
+        return token;
+    }
 
+    void dispatch(Connection& c, string_view line) {
+        if (!execute(sessions, c.token, c.panel, line)) c.closing = true;
+    }
 
-class Panel {
-    public:
-        void Action(int action) {
-            switch (action) {
-                case 1: showStudentInfo(); break;
-                case 2: checkBalance(); break;
-                case 3: viewReservations(); break;
-                case 4: viewShoppingCart(); break;
-                case 5: addToShoppingCart(); break;
-                case 6: confirmShoppingCart(); break;
-                case 7: removeShoppingCartItem(); break;
-                case 8: increaseBalance(); break;
-                case 9: viewRecentTransactions(); break;
-                case 10: cancelReservation(0); break;
-                case 0: exit(); break;
-                default: cout << "Invalid action." << endl;
+    static bool handle(StudentSession::Session& session, Panel& p, string_view line) {
+        Student* current = session.getCurrentStudent();
+        unique_lock<mutex> guard;
+        if (current) guard = unique_lock<mutex>(Storage::instance().getStudentLock(current->getUserId()));
+        string_view verb = nextToken(line);
+        int a = 0, b = 0;
+        uint64_t id = 0;
+        size_t page = 0;
+        if (verb == "LOGIN") {
+            if (!nextNumber(line, a)) {
+                p.invalidRequest();
+                return true;
             }
+            p.login(a, string(nextToken(line)));
         }
-    
-        void showMenu() {
-            cout << "1. Show Info\n2. Check Balance\n3. View Reservations\n4. View Shopping Cart\n"
-                 << "5. Add to Shopping Cart\n6. Confirm Shopping Cart\n7. Remove Cart Item\n"
-                 << "8. Increase Balance\n9. View Transactions\n10. Cancel Reservation\n0. Exit\n";
+        else if (verb == "STAFF") {
+            if (!nextNumber(line, a)) {
+                p.invalidRequest();
+                return true;
+            }
+            p.staffLogin(a, string(nextToken(line)));
         }
-    
-        void showStudentInfo() {
-            StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-            if (sm.getCurrentStudent())
-                sm.getCurrentStudent()->print();
-            else
-                cout << "No student logged in.\n";
+        else if (verb == "LOGOUT") p.logout();
+        else if (verb == "INFO") p.showStudentInfo();
+        else if (verb == "BALANCE") p.checkBalance();
+        else if (verb == "RESERVATIONS") p.viewReservations();
+        else if (verb == "CART") p.viewShoppingCart();
+        else if (verb == "ADD") {
+            if (!nextNumber(line, a) || !nextNumber(line, b)) {
+                p.invalidRequest();
+                return true;
+            }
+            p.addToShoppingCart(a, b);
         }
-    
-        void checkBalance() {
-            StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-            if (sm.getCurrentStudent())
-                cout << "Balance: " << sm.getCurrentStudent()->getAccountBalance() << endl;
+        else if (verb == "REMOVE") {
+            if (!nextNumber(line, id)) {
+                p.invalidRequest();
+                return true;
+            }
+            p.removeShoppingCartItem(id);
         }
-    
-        void viewReservations() {
-            StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-            vector<Reservation*> reserves = sm.getCurrentStudent()->getReserves();
-            for (auto* r : reserves) {
-                r->print();
-                cout << "-----------------------\n";
+        else if (verb == "CONFIRM") p.confirmShoppingCart();
+        else if (verb == "TOPUP") p.increaseBalance(nextToken(line));
+        else if (verb == "TRANSACTIONS") p.viewRecentTransactions();
+        else if (verb == "HISTORY") {
+            if (!nextNumber(line, page)) {
+                p.invalidRequest();
+                return true;
             }
+            p.viewTransactionHistory(page);
         }
-    
-        void viewShoppingCart() {
-            StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-            sm.getShoppingCart()->viewShoppingCartItems();
+        else if (verb == "ERRORS") p.viewRecentErrors();
+        else if (verb == "WAIT") {
+            if (!nextNumber(line, a) || !nextNumber(line, b)) {
+                p.invalidRequest();
+                return true;
+            }
+            p.joinWaitlist(a, b);
         }
-    
-        void addToShoppingCart() {
-            StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-    
-            int mealId;
-            cout << "Enter Meal ID to add to cart: ";
-            cin >> mealId;
-    
-            Meal* selectedMeal = nullptr;
-            for (auto& meal : Storage::instance().getMeals()) {
-                if (meal.getMealId() == mealId && meal.getIsActive()) {
-                    selectedMeal = &meal;
-                    break;
-                }
+        else if (verb == "UNWAIT") {
+            if (!nextNumber(line, a) || !nextNumber(line, b)) {
+                p.invalidRequest();
+                return true;
             }
-    
-            if (!selectedMeal) {
-                cout << "Invalid meal ID or inactive meal.\n";
-                return;
+            p.leaveWaitlist(a, b);
+        }
+        else if (verb == "MENU") {
+            if (!nextNumber(line, a) || !nextNumber(line, b)) {
+                p.invalidRequest();
+                return true;
             }
-    
-            int hallId;
-            cout << "Enter Dining Hall ID: ";
-            cin >> hallId;
-    
-            DiningHall* selectedHall = nullptr;
-            for (auto& hall : Storage::instance().getDiningHalls()) {
-                if (hall.getHallId() == hallId) {
-                    selectedHall = &hall;
-                    break;
-                }
+            p.viewMenu(a, b, nextToken(line));
+        }
+        else if (verb == "LOOKUP") {
+            if (!nextNumber(line, id)) {
+                p.invalidRequest();
+                return true;
             }
-    
-            if (!selectedHall) {
-                cout << "Invalid dining hall ID.\n";
-                return;
+            p.findReservation(id);
+        }
+        else if (verb == "CHECKIN") {
+            if (!nextNumber(line, id) || !nextNumber(line, a)) {
+                p.invalidRequest();
+                return true;
             }
-    
-            Reservation newRes;
-            newRes.setReservationId(IDGenerator::generateReservationId());
-            newRes.setMeal(selectedMeal);
-            newRes.setDiningHall(selectedHall);
-            newRes.setStatus(RStatus::NOT_PAID);
-    
-            sm.getShoppingCart()->addReservation(newRes);
-            cout << "Reservation added to cart.\n";
+            p.checkIn(id, a);
         }
-    
-        void confirmShoppingCart() {
-            StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-            Student* student = sm.getCurrentStudent();
-            vector<Reservation> items = sm.getShoppingCart()->getReservations();
-    
-            float total = 0.0;
-            for (auto& res : items) {
-                total += res.getMeal()->getPrice();
+        else if (verb == "CANCEL") {
+            if (!nextNumber(line, id)) {
+                p.invalidRequest();
+                return true;
             }
-    
-            if (student->getAccountBalance() < total) {
-                cout << "Insufficient balance.\n";
-                return;
+            p.cancelReservation(id);
+        }
+        else if (verb == "QUIT") {
+            p.exit();
+            return false;
+        }
+        else p.invalidRequest();
+        return true;
+    }
+
+public:
+    // Runs one request line against a session; the response is left in the Panel's view. False means QUIT.
+    // Seats freed by the request go to waiting students once the caller's student lock is released.
+    static bool execute(StudentSession::Session& session, Panel& p, string_view line) {
+        bool more = handle(session, p, line);
+        WaitlistEngine::instance().promotePending();
+        return more;
+    }
+
+    // Same, for a session held in a table. A token the reaper has expired is replaced by a fresh, logged-out one.
+    static bool execute(StudentSession::SessionTable& table, uint64_t& token, Panel& p, string_view line) {
+        bool more = true;
+        while (!table.withSession(token, [&](StudentSession::Session& s) {
+            p.bind(s);
+            more = handle(s, p, line);
+        }))
+            token = table.open(nullptr);
+        WaitlistEngine::instance().promotePending();
+        return more;
+    }
+
+    static constexpr int64_t kIdleSeconds = 30 * 60;
+    static constexpr int kReapSeconds = 60;
+
+    StudentSession::SessionTable& getSessions() { return sessions; }
+
+private:
+
+    void setInterest(Reactor& r, Connection& c, uint32_t interest) {
+        if (interest == c.interest) return;
+        epoll_event ev{};
+        ev.events = interest;
+        ev.data.ptr = &c;
+        epoll_ctl(r.epfd, EPOLL_CTL_MOD, c.fd, &ev);
+        c.interest = interest;
+    }
+
+    void closeConnection(Reactor& r, Connection& c) {
+        epoll_ctl(r.epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        sessions.close(c.token);
+        r.connections.erase(c.fd);
+    }
+
+    // Returns false once the peer is gone.
+    bool flush(Connection& c) {
+        while (c.outOffset < c.out.size()) {
+            ssize_t n = send(c.fd, c.out.data() + c.outOffset, c.out.size() - c.outOffset, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (n <= 0) return false;
+            c.outOffset += static_cast<size_t>(n);
+        }
+        c.out.clear();
+        c.outOffset = 0;
+        return true;
+    }
+
+    // Everything already buffered is executed in order and answered with a single send, after a single wait for
+    // the log to make all of it durable. Replies that depended on that wait are swapped out if it fails.
+    bool readable(Connection& c) {
+        char buf[kReadChunk];
+        ssize_t n = ::read(c.fd, buf, sizeof(buf));
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        if (n == 0) return false;
+        c.in.append(buf, static_cast<size_t>(n));
+
+        WriteAheadLog& wal = WriteAheadLog::instance();
+        WriteAheadLog::Batch& batch = WriteAheadLog::batch();
+        Renderer& view = c.panel.getView();
+        thread_local vector<pair<size_t, bool>> replies;  // end of each reply in the view, and whether it was deferred
+        replies.clear();
+        wal.beginBatch();
+        size_t start = 0;
+        for (size_t nl; !c.closing && (nl = c.in.find('\n', start)) != string::npos; start = nl + 1) {
+            string_view line(c.in.data() + start, nl - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+            batch.deferred = false;
+            dispatch(c, line);
+            replies.emplace_back(view.data().size(), batch.deferred);
+        }
+        bool durable = wal.endBatch();
+        c.in.erase(0, start);
+        if (c.in.size() > kMaxLine) return false;
+
+        if (durable) {
+            c.out.append(view.data());
+        } else {
+            string rendered(view.data());
+            size_t from = 0;
+            for (auto& reply : replies) {
+                view.clear();
+                if (reply.second) c.panel.notDurable();
+                c.out.append(reply.second ? view.data() : rendered.substr(from, reply.first - from));
+                from = reply.first;
             }
-    
-            student->setAccountBalance(student->getAccountBalance() - total);
+        }
+        view.clear();
+        return flush(c);
+    }
+
+    void adopt(Reactor& r) {
+        uint64_t ticks;
+        while (::read(r.wakeFd, &ticks, sizeof(ticks)) > 0) {}
+        vector<int> fds;
+        {
+            lock_guard<mutex> guard(r.inboxLock);
+            fds.swap(r.inbox);
+        }
+        for (int fd : fds) {
+            auto conn = make_unique<Connection>(fd, sessions.open(nullptr));
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = conn.get();
+            if (epoll_ctl(r.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                sessions.close(conn->token);
+                ::close(fd);
+                continue;
+            }
+            r.connections.emplace(fd, move(conn));
+        }
+    }
+
+    void acceptAll() {
+        for (;;) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            if (!unixSocket) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            Reactor& target = *reactors[nextReactor.fetch_add(1, memory_order_relaxed) % reactors.size()];
+            {
+                lock_guard<mutex> guard(target.inboxLock);
+                target.inbox.push_back(fd);
+            }
+            uint64_t one = 1;
+            if (::write(target.wakeFd, &one, sizeof(one)) < 0) {}
+        }
+    }
+
+    void run(Reactor& r) {
+        epoll_event events[kMaxEvents];
+        while (!stopping.load(memory_order_acquire)) {
+            int n = epoll_wait(r.epfd, events, kMaxEvents, -1);
+            if (n < 0 && errno != EINTR) break;
+            for (int i = 0; i < n; ++i) {
+                void* tag = events[i].data.ptr;
+                if (tag == &listenTag) {
+                    acceptAll();
+                    continue;
+                }
+                if (tag == &r) {
+                    adopt(r);
+                    continue;
+                }
+                Connection& c = *static_cast<Connection*>(tag);
+                bool alive = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) alive = readable(c);
+                else if (events[i].events & EPOLLOUT) alive = flush(c);
+                bool pending = c.outOffset < c.out.size();
+                if (!alive || (c.closing && !pending)) {
+                    closeConnection(r, c);
+                    continue;
+                }
+                // A client that stops reading stops being read from.
+                uint32_t interest = pending ? static_cast<uint32_t>(EPOLLOUT) : 0u;
+                if (!c.closing && c.out.size() - c.outOffset < kMaxPendingOutput) interest |= EPOLLIN;
+                setInterest(r, c, interest);
+            }
+        }
+    }
+
+    bool bindAndListen(int fd, const sockaddr* addr, socklen_t len) {
+        if (::bind(fd, addr, len) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+            ::close(fd);
+            return false;
+        }
+        listenFd = fd;
+        return true;
+    }
+
+public:
+    explicit Server(size_t reactorCount)
+        : listenFd(-1), unixSocket(false), port(0), stopping(false), nextReactor(0), listenTag(0) {
+        for (size_t i = 0; i < max<size_t>(reactorCount, 1); ++i) reactors.push_back(make_unique<Reactor>());
+    }
+    Server(const Server&) = delete;
+    void operator=(const Server&) = delete;
+    ~Server() { stop(); }
+
+    // Loopback only; port 0 picks a free port, readable through getPort().
+    bool listenTcp(uint16_t requested) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(requested);
+        if (!bindAndListen(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) return false;
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        return true;
+    }
+
+    bool listenUnix(const string& path) {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) return false;
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        unlink(path.c_str());
+        unixSocket = true;
+        return bindAndListen(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+
+    uint16_t getPort() const { return port; }
+
+    // Reactor 0 also owns the listening socket and deals accepted connections out round-robin.
+    bool start() {
+        if (listenFd < 0) return false;
+        for (auto& r : reactors) {
+            r->epfd = epoll_create1(EPOLL_CLOEXEC);
+            r->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (r->epfd < 0 || r->wakeFd < 0) return false;
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = r.get();
+            epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->wakeFd, &ev);
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &listenTag;
+        epoll_ctl(reactors[0]->epfd, EPOLL_CTL_ADD, listenFd, &ev);
+        for (auto& r : reactors) r->worker = thread(&Server::run, this, ref(*r));
+        sessions.startReaper(kIdleSeconds, kReapSeconds);
+        return true;
+    }
+
+    void stop() {
+        stopping.store(true, memory_order_release);
+        for (auto& r : reactors) {
+            if (r->wakeFd >= 0) {
+                uint64_t one = 1;
+                if (::write(r->wakeFd, &one, sizeof(one)) < 0) {}
+            }
+            if (r->worker.joinable()) r->worker.join();
+            for (auto& entry : r->connections) {
+                ::close(entry.first);
+                sessions.close(entry.second->token);
+            }
+            r->connections.clear();
+            for (int fd : r->inbox) ::close(fd);
+            r->inbox.clear();
+            if (r->epfd >= 0) ::close(r->epfd);
+            if (r->wakeFd >= 0) ::close(r->wakeFd);
+            r->epfd = r->wakeFd = -1;
+        }
+        if (listenFd >= 0) ::close(listenFd);
+        listenFd = -1;
+        sessions.stopReaper();
+    }
+};
+#ifdef ALLOC_CHECK
+#include <cstdlib>
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace AllocCheck {
+    atomic<size_t> allocations(0);
+
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char*, streamsize n) override { return n; }
+    };
+
+    int readPaths() {
+        Meal meal;
+        meal.setMealId(Storage::instance().generateMealId());
+        meal.setName("Kebab");
+        meal.addSideItem("rice");
+        Meal& storedMeal = Storage::instance().addMeal(move(meal));
+        DiningHall hall;
+        hall.setHallId(Storage::instance().generateDiningHallId());
+        hall.setCapacity(100);
+        DiningHall& storedHall = Storage::instance().addDiningHall(move(hall));
+
+        Student student(1, "400000001", "Sara", "Ahmadi", "sara@example.com", "0912", Money::fromUnits(500), "x");
+        for (int i = 0; i < 50; ++i) {
+            student.addReservation(&Storage::instance().addReservation(
+                Reservation(IDGenerator::generateReservationId(), &storedHall, &storedMeal), student.getUserId()));
             Transaction t;
-        t.setTransactionID(IDGenerator::generateTransactionId());
-        t.setAmount(total);
-        t.setType(TransactionType::PAYMENT);
-        t.setStatus(TransactionStatus::COMPLETED);
-        t.setCreatedAt(time(0));
-        student->addTransaction(t);
+            t.setTransactionID(IDGenerator::generateTransactionId());
+            t.setTrackingCode("TRK-" + to_string(i));
+            t.setAmount(Money::fromUnits(10));
+            student.addTransaction(move(t));
+        }
+        StudentSession::SessionManager::instance().setCurrentStudent(&student);
+
+        NullBuffer sink;
+        streambuf* console = cout.rdbuf(&sink);
+        Panel panel;
+        panel.viewReservations();
+        panel.viewRecentTransactions();
+
+        size_t before = allocations.load();
+        panel.viewReservations();
+        size_t reservationAllocs = allocations.load() - before;
+        before = allocations.load();
+        panel.viewRecentTransactions();
+        size_t transactionAllocs = allocations.load() - before;
+        cout.rdbuf(console);
+
+        cout << "viewReservations allocations: " << reservationAllocs << endl;
+        cout << "viewRecentTransactions allocations: " << transactionAllocs << endl;
+        StudentSession::SessionManager::instance().setCurrentStudent(nullptr);
+        return reservationAllocs == 0 && transactionAllocs == 0 ? 0 : 1;
+    }
+}
+
+void* operator new(size_t n) {
+    AllocCheck::allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
+
+namespace Bench {
+
+    template <typename F>
+    double nsPerOp(size_t ops, F&& body) {
+        auto start = chrono::steady_clock::now();
+        body();
+        auto elapsed = chrono::steady_clock::now() - start;
+        return chrono::duration<double, nano>(elapsed).count() / ops;
+    }
+
+    void mealLookup() {
+        for (size_t n : {size_t(1000), size_t(100000), size_t(1000000)}) {
+            vector<Meal> meals(n);
+            IdIndex index;
+            for (size_t i = 0; i < n; ++i) {
+                meals[i].setMealId(static_cast<int>(i + 1));
+                index.insert(static_cast<int>(i + 1), i);
+            }
+
+            mt19937 rng(42);
+            uniform_int_distribution<int> pick(1, static_cast<int>(n));
+            size_t scanOps = n >= 1000000 ? 200 : 2000;
+            size_t indexOps = 1000000;
+            vector<int> ids(indexOps);
+            for (auto& id : ids) id = pick(rng);
 
-        for (auto& res : items) {
-            Reservation* r = new Reservation(res);
-            r->setStatus(RStatus::SUCCESS);
-            student->getReserves().push_back(r);
+            size_t hits = 0;
+            double scan = nsPerOp(scanOps, [&] {
+                for (size_t k = 0; k < scanOps; ++k)
+                    for (auto& meal : meals)
+                        if (meal.getMealId() == ids[k]) { ++hits; break; }
+            });
+            double indexed = nsPerOp(indexOps, [&] {
+                for (int id : ids)
+                    if (index.find(id) != IdIndex::npos) ++hits;
+            });
+
+            cout << "meals=" << n << " linear=" << scan << "ns/op indexed=" << indexed
+                 << "ns/op hits=" << hits << endl;
         }
+    }
 
-        sm.getShoppingCart()->clear();
-        cout << "Reservation(s) confirmed.\n";
+    void idScaling() {
+        const size_t perThread = 4000000;
+        unsigned cores = max(1u, thread::hardware_concurrency());
+        for (bool ordered : {false, true}) {
+            IDGenerator::setTimeOrdered(ordered);
+            for (unsigned threads = 1; threads <= cores; threads *= 2) {
+                atomic<uint64_t> sink(0);
+                double ns = nsPerOp(perThread * threads, [&] {
+                    vector<thread> workers;
+                    for (unsigned t = 0; t < threads; ++t) {
+                        workers.emplace_back([&] {
+                            uint64_t mix = 0;
+                            for (size_t i = 0; i < perThread; ++i) mix ^= IDGenerator::generateReservationId();
+                            sink.fetch_xor(mix);
+                        });
+                    }
+                    for (auto& w : workers) w.join();
+                });
+                cout << (ordered ? "time-ordered" : "leased") << " threads=" << threads
+                     << " " << 1000.0 / ns << "M ids/s" << endl;
+                if (threads < cores && threads * 2 > cores) threads = cores / 2;
+            }
+        }
+        IDGenerator::setTimeOrdered(false);
     }
 
-    void removeShoppingCartItem() {
-        int id;
-        cout << "Enter Reservation ID to remove: ";
-        cin >> id;
+    // Menu lookups per second as readers are added while one thread keeps republishing prices.
+    void menuReads() {
+        const size_t perThread = 2000000;
+        const int mealCount = 3000;
+        Storage& storage = Storage::instance();
+        for (int i = 0; i < mealCount; ++i) {
+            Meal m;
+            m.setMealId(storage.generateMealId());
+            m.setReserveDay(static_cast<ReserveDay>(i % 5));
+            m.setMealType(static_cast<MealType>(i / 5 % 3));
+            m.setPrice(Money::fromUnits(20));
+            storage.addMeal(move(m));
+        }
+        MenuCatalog::instance().refresh();
+        unsigned cores = max(1u, thread::hardware_concurrency());
+        for (unsigned threads = 1; threads <= cores; threads *= 2) {
+            atomic<bool> done(false);
+            atomic<uint64_t> sink(0), versions(0);
+            thread writer([&] {
+                for (int64_t cents = 2000; !done.load(memory_order_relaxed); ++cents) {
+                    MenuCatalog::instance().updatePrice(1 + static_cast<int>(cents % mealCount), Money::fromCents(cents));
+                    versions.fetch_add(1, memory_order_relaxed);
+                    this_thread::sleep_for(chrono::microseconds(100));
+                }
+            });
+            double ns = nsPerOp(perThread * threads, [&] {
+                vector<thread> workers;
+                for (unsigned t = 0; t < threads; ++t) {
+                    workers.emplace_back([&, t] {
+                        int64_t mix = 0;
+                        for (size_t i = 0; i < perThread; ++i) {
+                            MenuCatalog::Reader menu;
+                            const MenuCatalog::Item* item = menu->find(1 + static_cast<int>((i * 7 + t) % mealCount));
+                            if (item && item->active) mix += item->price.getCents();
+                        }
+                        sink.fetch_add(static_cast<uint64_t>(mix));
+                    });
+                }
+                for (auto& w : workers) w.join();
+            });
+            done = true;
+            writer.join();
+            cout << "threads=" << threads << " " << 1000.0 / ns << "M lookups/s versions=" << versions.load() << endl;
+            if (threads < cores && threads * 2 > cores) threads = cores / 2;
+        }
+    }
 
-        StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-        sm.getShoppingCart()->removeReservation(id);
+    // Imports a generated million-row menu from CSV, exports it as binary and imports that back.
+    void bulkImport() {
+        const size_t rows = 1000000;
+        const string csvPath = "bench-menu.csv", binPath = "bench-menu.bin";
+        {
+            static const char* types[] = {"breakfast", "lunch", "dinner"};
+            static const char* days[] = {"saturday", "sunday", "monday", "tuesday", "wednesday"};
+            static const char* sides[] = {"rice", "rice;salad", "salad;yogurt", "", "bread;soup;salad"};
+            ofstream out(csvPath);
+            out << "name,price,type,day,active,sides\n";
+            for (size_t i = 0; i < rows; ++i)
+                out << "meal " << i << ',' << 10 + i % 40 << '.' << (i % 4) * 25 << ',' << types[i % 3] << ','
+                    << days[i / 3 % 5] << ',' << (i % 50 ? 1 : 0) << ',' << sides[i % 5] << '\n';
+        }
+        auto timed = [](const char* label, auto&& body) {
+            auto start = chrono::steady_clock::now();
+            body();
+            cout << label << " " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << "ms" << endl;
+        };
+        ImportReport csv, bin;
+        timed("import csv", [&] { csv = BulkCatalog::importMeals(csvPath); });
+        timed("export binary", [&] { BulkCatalog::exportMeals(binPath, BulkFormat::BINARY); });
+        timed("import binary", [&] { bin = BulkCatalog::importMeals(binPath); });
+        cout << "rows csv=" << csv.rows << " binary=" << bin.rows << " meals=" << Storage::instance().getMeals().size() << endl;
+        unlink(csvPath.c_str());
+        unlink(binPath.c_str());
     }
 
-    void increaseBalance() {
-        float amount;
-        cout << "Enter amount to add: ";
-        cin >> amount;
+    void analytics() {
+        const size_t rows = 10000000;
+        const int halls = 20;
+        vector<Meal> meals(5 * 3);
+        for (size_t i = 0; i < meals.size(); ++i) {
+            meals[i].setMealId(static_cast<int>(i + 1));
+            meals[i].setReserveDay(static_cast<ReserveDay>(i / 3));
+            meals[i].setMealType(static_cast<MealType>(i % 3));
+            meals[i].setPrice(Money::fromUnits(static_cast<int64_t>(20 + i)));
+        }
+        vector<DiningHall> diningHalls(halls);
+        for (int h = 0; h < halls; ++h) diningHalls[h].setHallId(h + 1);
 
-        StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-        Student* student = sm.getCurrentStudent();
-        student->setAccountBalance(student->getAccountBalance() + amount);
-        cout << "Balance increased.\n";
+        ReservationTable reservations;
+        TransactionTable transactions;
+        mt19937 rng(7);
+        Reservation res(0, &diningHalls[0], &meals[0]);
+        Transaction t;
+        for (size_t i = 0; i < rows; ++i) {
+            uint32_t r = rng();
+            res.setReservationId(i);
+            res.setMeal(&meals[r % meals.size()]);
+            res.setDiningHall(&diningHalls[(r >> 8) % halls]);
+            res.setStatus((r >> 16) % 10 == 0 ? RStatus::CANCELLED : RStatus::SUCCESS);
+            reservations.append(res, static_cast<int>(r >> 12));
+            t.setTransactionID(i);
+            t.setAmount(Money::fromCents(r % 5000));
+            t.setType((r >> 20) % 4 == 0 ? TransactionType::TRANSFER : TransactionType::PAYMENT);
+            t.setStatus((r >> 24) % 20 == 0 ? TransactionStatus::FAILED : TransactionStatus::COMPLETED);
+            transactions.append(t, static_cast<int>(r >> 12));
+        }
+
+        Analytics::ReservationFilter lunches;
+        lunches.hallId = 3;
+        lunches.day = static_cast<int>(ReserveDay::MONDAY);
+        lunches.mealType = static_cast<int>(MealType::LUNCH);
+        lunches.status = static_cast<int>(RStatus::SUCCESS);
+        Analytics::TransactionFilter payments;
+        payments.type = static_cast<int>(TransactionType::PAYMENT);
+        payments.status = static_cast<int>(TransactionStatus::COMPLETED);
+
+        for (bool simd : {false, true}) {
+            Analytics::setSimdEnabled(simd);
+            Analytics::Aggregate a, p;
+            Analytics::HeadcountGrid grid;
+            double filtered = nsPerOp(rows, [&] { a = Analytics::aggregate(reservations, lunches); });
+            double planned = nsPerOp(rows, [&] { grid = Analytics::headcounts(reservations, 3); });
+            double finance = nsPerOp(rows, [&] { p = Analytics::aggregate(transactions, payments); });
+            cout << (simd ? "avx2  " : "scalar") << " rows=" << rows
+                 << " filter=" << filtered * rows / 1e6 << "ms (count=" << a.count << " revenue=" << Money::fromCents(a.sum) << ")"
+                 << " headcounts=" << planned * rows / 1e6 << "ms (mon lunch=" << grid.cells[2][1].count << ")"
+                 << " payments=" << finance * rows / 1e6 << "ms (sum=" << Money::fromCents(p.sum) << ")" << endl;
+        }
+        Analytics::setSimdEnabled(true);
     }
 
-    void viewRecentTransactions() {
-        StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-        vector<Transaction> txs = sm.getCurrentStudent()->getTransactions();
+    void seatContention() {
+        const int threads = 64;
+        const int capacity = 1000000;
+        CapacityLedger ledger;
+        size_t hall = ledger.addHall(capacity);
+        DateTime monday = DateTime::nextOccurrence(ReserveDay::MONDAY, DateTime::now());
+
+        atomic<int> granted(0);
+        atomic<bool> go(false);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                while (!go.load(memory_order_acquire)) {}
+                int mine = 0;
+                while (ledger.tryReserve(hall, monday, MealType::LUNCH)) ++mine;
+                granted.fetch_add(mine);
+            });
+        }
+
+        double ns = nsPerOp(capacity, [&] {
+            go.store(true, memory_order_release);
+            for (auto& w : workers) w.join();
+        });
+
+        cout << "threads=" << threads << " seats=" << capacity << " granted=" << granted.load()
+             << " left=" << ledger.remaining(hall, monday, MealType::LUNCH)
+             << " " << ns << "ns/seat" << endl;
+    }
+
+    bool ledgerStress() {
+        const int threads = 8;
+        const int opsPerThread = 500000;
+        const Money opening = Money::fromUnits(100);
+        Student student(1, "400000001", "Sara", "Ahmadi", "sara@example.com", "0912", opening, "x");
+
+        atomic<int64_t> ledgerCents(0);
+        atomic<size_t> declined(0);
+        atomic<bool> go(false);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                mt19937_64 rng(t);
+                while (!go.load(memory_order_acquire)) {}
+                int64_t mine = 0;
+                size_t failed = 0;
+                for (int i = 0; i < opsPerThread; ++i) {
+                    Money amount = Money::fromCents(static_cast<int64_t>(rng() % 5000) + 1);
+                    if (i & 1) {
+                        Transaction tx = BalanceLedger::debit(student, amount);
+                        if (tx.getStatus() == TransactionStatus::COMPLETED) mine -= tx.getAmount().getCents();
+                        else ++failed;
+                    } else {
+                        mine += BalanceLedger::credit(student, amount).getAmount().getCents();
+                    }
+                }
+                ledgerCents.fetch_add(mine);
+                declined.fetch_add(failed);
+            });
+        }
+
+        double ns = nsPerOp(static_cast<size_t>(threads) * opsPerThread, [&] {
+            go.store(true, memory_order_release);
+            for (auto& w : workers) w.join();
+        });
+
+        Money expected = opening + Money::fromCents(ledgerCents.load());
+        bool ok = student.getAccountBalance() == expected;
+        cout << "threads=" << threads << " ops=" << threads * opsPerThread << " declined=" << declined.load()
+             << " balance=" << student.getAccountBalance() << " ledger=" << expected
+             << (ok ? " ok " : " MISMATCH ") << ns << "ns/op" << endl;
+        return ok;
+    }
+
+}
+
+// End-to-end load generator. Seeds students, halls and meals, then drives request lines either straight into
+// Server::execute ("direct") or through a loopback Server ("tcp") and reports latency percentiles per action.
+namespace LoadGen {
+
+    enum Action { LOGIN, ADD, REMOVE, CONFIRM, TOPUP, CANCEL, RESERVATIONS, BALANCE, TRANSACTIONS, INFO, kActions };
+    const char* const kActionNames[kActions] = {"login", "add", "remove", "confirm", "topup",
+                                                 "cancel", "reservations", "balance", "transactions", "info"};
 
-        cout << "Recent Transactions:\n";
-        for (const auto& t : txs) {
-            cout << "ID: " << t.getTransactionID() << ", Amount: " << t.getAmount()
-                 << ", Type: " << (t.getType() == TransactionType::PAYMENT ? "Payment" : "Transfer")
-                 << ", Status: ";
-            switch (t.getStatus()) {
-                case TransactionStatus::PENDING: cout << "Pending"; break;
-                case TransactionStatus::COMPLETED: cout << "Completed"; break;
-                case TransactionStatus::FAILED: cout << "Failed"; break;
+    struct Config {
+        int students = 2000;
+        int halls = 12;
+        int meals = 45;
+        int clients = 8;
+        int popularHalls = 3;
+        double seconds = 5;
+        bool tcp = false;
+        uint64_t seed = 42;
+        string events = "/dev/null";
+
+        bool set(string_view key, const char* value) {
+            if (key == "students") students = max(1, atoi(value));
+            else if (key == "halls") halls = max(1, atoi(value));
+            else if (key == "meals") meals = max(3, atoi(value));
+            else if (key == "clients") clients = max(1, atoi(value));
+            else if (key == "popular") popularHalls = max(1, atoi(value));
+            else if (key == "seconds") seconds = atof(value);
+            else if (key == "seed") seed = strtoull(value, nullptr, 10);
+            else if (key == "transport") tcp = string_view(value) == "tcp";
+            else if (key == "events") events = value;
+            else return false;
+            return true;
+        }
+    };
+
+    class Client {
+    public:
+        virtual ~Client() {}
+        // Sends one request line and returns its single response line.
+        virtual string_view call(string_view line) = 0;
+    };
+
+    class DirectClient : public Client {
+        StudentSession::SessionTable& sessions;
+        uint64_t token;
+        Panel panel;
+        string response;
+
+    public:
+        explicit DirectClient(StudentSession::SessionTable& table)
+            : sessions(table), token(table.open(nullptr)), panel(OutputMode::JSON, nullptr) {}
+        ~DirectClient() override { sessions.close(token); }
+
+        string_view call(string_view line) override {
+            Server::execute(sessions, token, panel, line);
+            response.assign(panel.getView().data());
+            panel.getView().clear();
+            return response;
+        }
+    };
+
+    class TcpClient : public Client {
+        int fd;
+        string request;
+        string in;
+        size_t consumed;
+
+    public:
+        explicit TcpClient(uint16_t port) : fd(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)), consumed(0) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port);
+            int one = 1;
+            if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        ~TcpClient() override {
+            if (fd >= 0) ::close(fd);
+        }
+
+        string_view call(string_view line) override {
+            request.assign(line.data(), line.size());
+            request.push_back('\n');
+            if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) return {};
+            in.erase(0, consumed);
+            size_t nl;
+            while ((nl = in.find('\n')) == string::npos) {
+                char buf[16384];
+                ssize_t n = ::read(fd, buf, sizeof(buf));
+                if (n <= 0) return {};
+                in.append(buf, static_cast<size_t>(n));
+            }
+            consumed = nl + 1;
+            return string_view(in.data(), nl + 1);
+        }
+    };
+
+    void seed(const Config& cfg) {
+        Storage& storage = Storage::instance();
+        for (int i = 0; i < cfg.meals; ++i) {
+            Meal meal;
+            meal.setMealId(storage.generateMealId());
+            meal.setName("Meal " + to_string(i));
+            meal.setPrice(Money::fromUnits(5 + i % 20));
+            meal.setMealType(static_cast<MealType>(i % 3));
+            meal.setReserveDay(static_cast<ReserveDay>(i / 3 % 5));
+            storage.addMeal(move(meal));
+        }
+        MenuCatalog::instance().refresh();
+        // Popular halls are sized so the lunch rush can actually fill them.
+        int perHall = max(1, cfg.students / cfg.halls);
+        for (int i = 0; i < cfg.halls; ++i) {
+            DiningHall hall;
+            hall.setHallId(storage.generateDiningHallId());
+            hall.setName("Hall " + to_string(i));
+            hall.setCapacity(i < cfg.popularHalls ? perHall : perHall * 4);
+            storage.addDiningHall(move(hall));
+        }
+        for (int i = 1; i <= cfg.students; ++i)
+            storage.addStudent(Student(i, to_string(400000000 + i), "Student", to_string(i), "s" + to_string(i) + "@example.com",
+                                       "0912", Money::fromUnits(200), "pw"));
+    }
+
+    struct Samples {
+        vector<uint32_t> ns[kActions];
+        size_t failures[kActions] = {};
+    };
+
+    // Finds the id of a confirmed reservation in a RESERVATIONS response, or 0.
+    uint64_t activeReservation(string_view json) {
+        size_t at = json.find("\"status\":\"Success\"");
+        if (at == string_view::npos) return 0;
+        size_t id = json.rfind("{\"id\":", at);
+        if (id == string_view::npos) return 0;
+        uint64_t value = 0;
+        from_chars(json.data() + id + 6, json.data() + at, value);
+        return value;
+    }
+
+    void drive(const Config& cfg, Client& client, int worker, chrono::steady_clock::time_point start,
+               chrono::steady_clock::time_point deadline, Samples& out) {
+        mt19937_64 rng(cfg.seed * 7919 + static_cast<uint64_t>(worker));
+        int first = worker * cfg.students / cfg.clients + 1;
+        int last = (worker + 1) * cfg.students / cfg.clients;
+        if (last < first) return;
+        char line[96];
+
+        auto timed = [&](Action action, string_view request) {
+            auto t0 = chrono::steady_clock::now();
+            string_view response = client.call(request);
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+            out.ns[action].push_back(static_cast<uint32_t>(min<int64_t>(elapsed, UINT32_MAX)));
+            if (response.empty() || response.compare(0, 8, "{\"error\"") == 0) ++out.failures[action];
+            return response;
+        };
+        auto format = [&](const char* fmt, auto... args) {
+            int n = snprintf(line, sizeof(line), fmt, args...);
+            return string_view(line, static_cast<size_t>(max(n, 0)));
+        };
+
+        while (chrono::steady_clock::now() < deadline) {
+            int student = first + static_cast<int>(rng() % static_cast<uint64_t>(last - first + 1));
+            timed(LOGIN, format("LOGIN %d pw", student));
+
+            // The first 300 ms of every second is a lunch rush on the popular halls.
+            auto sinceStart = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            bool rush = sinceStart % 1000 < 300;
+            unsigned roll = static_cast<unsigned>(rng() % 100);
+
+            if (roll < (rush ? 85u : 45u)) {
+                // Seeded meals cycle breakfast, lunch, dinner, so lunches have ids 2, 5, 8, ...
+                int meal = 2 + 3 * static_cast<int>(rng() % static_cast<uint64_t>(cfg.meals / 3));
+                bool popular = rng() % 100 < (rush ? 90u : 40u);
+                int hall = 1 + static_cast<int>(rng() % static_cast<uint64_t>(popular ? min(cfg.popularHalls, cfg.halls) : cfg.halls));
+                timed(ADD, format("ADD %d %d", meal, hall));
+                if (rng() % 10 == 0) {
+                    timed(ADD, format("ADD %d %d", 1 + static_cast<int>(rng() % static_cast<uint64_t>(cfg.meals)), hall));
+                    timed(REMOVE, format("REMOVE %llu", static_cast<unsigned long long>(rng() % 1000)));
+                }
+                timed(CONFIRM, "CONFIRM");
+            } else if (roll < 65) {
+                timed(TOPUP, format("TOPUP %d.%02d", 5 + static_cast<int>(rng() % 50), static_cast<int>(rng() % 100)));
+            } else if (roll < 80) {
+                uint64_t id = activeReservation(timed(RESERVATIONS, "RESERVATIONS"));
+                if (id) timed(CANCEL, format("CANCEL %llu", static_cast<unsigned long long>(id)));
+            } else if (roll < 90) {
+                timed(BALANCE, "BALANCE");
+            } else if (roll < 97) {
+                timed(TRANSACTIONS, "TRANSACTIONS");
+            } else {
+                timed(INFO, "INFO");
             }
-            time_t created = t.getCreatedAt();
-            cout << ", Date: " << ctime(&created);
+            client.call("LOGOUT");
         }
     }
 
-    void cancelReservation(int id) {
-        StudentSession::SessionManager& sm = StudentSession::SessionManager::instance();
-        vector<Reservation*> resList = sm.getCurrentStudent()->getReserves();
+    int run(int argc, char* argv[]) {
+        Config cfg;
+        for (int i = 2; i < argc; ++i) {
+            const char* eq = strchr(argv[i], '=');
+            if (!eq || !cfg.set(string_view(argv[i], static_cast<size_t>(eq - argv[i])), eq + 1)) {
+                cout << "usage: loadgen [students=N] [halls=N] [meals=N] [popular=N] [clients=N] [seconds=S] "
+                        "[transport=direct|tcp] [seed=N] [events=path]" << endl;
+                return 2;
+            }
+        }
+        seed(cfg);
+        if (!EventLog::instance().open(cfg.events)) cout << "Failed to open event log " << cfg.events << endl;
+
+        Server server(max(1u, thread::hardware_concurrency()));
+        if (cfg.tcp && (!server.listenTcp(0) || !server.start())) {
+            cout << "Failed to start loopback server" << endl;
+            return 1;
+        }
+        if (!cfg.tcp) server.getSessions().startReaper(Server::kIdleSeconds, Server::kReapSeconds);
+
+        vector<unique_ptr<Client>> clients;
+        for (int i = 0; i < cfg.clients; ++i) {
+            if (cfg.tcp) clients.push_back(make_unique<TcpClient>(server.getPort()));
+            else clients.push_back(make_unique<DirectClient>(server.getSessions()));
+        }
+
+        vector<Samples> samples(static_cast<size_t>(cfg.clients));
+        auto start = chrono::steady_clock::now();
+        auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(cfg.seconds));
+        vector<thread> workers;
+        for (int i = 0; i < cfg.clients; ++i)
+            workers.emplace_back(drive, cref(cfg), ref(*clients[static_cast<size_t>(i)]), i, start, deadline,
+                                 ref(samples[static_cast<size_t>(i)]));
+        for (auto& w : workers) w.join();
+        double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        clients.clear();
+        server.stop();
+        EventLog::instance().close();
 
-        for (auto* r : resList) {
-            if (r->getReservationId() == id && r->getStatus() == RStatus::SUCCESS) {
-                r->setStatus(RStatus::CANCELLED);
-                cout << "Reservation cancelled.\n";
-                return;
+        cout << "transport=" << (cfg.tcp ? "tcp" : "direct") << " students=" << cfg.students << " halls=" << cfg.halls
+             << " meals=" << cfg.meals << " clients=" << cfg.clients << " seconds=" << wall << endl;
+        char row[160];
+        snprintf(row, sizeof(row), "%-13s %10s %10s %8s %10s %10s %10s", "action", "count", "ops/s", "errors", "p50(us)",
+                 "p99(us)", "p999(us)");
+        cout << row << endl;
+        size_t total = 0;
+        for (int a = 0; a < kActions; ++a) {
+            vector<uint32_t> all;
+            size_t failures = 0;
+            for (auto& s : samples) {
+                all.insert(all.end(), s.ns[a].begin(), s.ns[a].end());
+                failures += s.failures[a];
             }
+            if (all.empty()) continue;
+            sort(all.begin(), all.end());
+            auto pct = [&](double q) { return all[min(all.size() - 1, static_cast<size_t>(q * all.size()))] / 1000.0; };
+            total += all.size();
+            snprintf(row, sizeof(row), "%-13s %10zu %10.0f %8zu %10.1f %10.1f %10.1f", kActionNames[a], all.size(),
+                     all.size() / wall, failures, pct(0.50), pct(0.99), pct(0.999));
+            cout << row << endl;
         }
-        cout << "Reservation not found or not cancellable.\n";
+        cout << "total " << total << " requests, " << static_cast<size_t>(total / wall) << " req/s" << endl;
+        return 0;
     }
 
-    void exit() {
-        cout << "Goodbye!\n";
+}
+
+// Loads each setup file whose kind Storage has none of yet. After recovery that means a fresh deployment; the
+// rows are logged, so later restarts recover them instead of loading the files again. Staff are never logged,
+// so their file is loaded on every start.
+static bool loadSetup(const string& halls, const string& meals, const string& students, const string& staff) {
+    Storage& storage = Storage::instance();
+    Admin admin;
+    ImportReport report;
+    auto load = [&](const string& path, bool loaded, bool (Admin::*import)(const string&, ImportReport&)) {
+        if (path.empty()) return true;
+        if (loaded) {
+            cout << "Skipping " << path << ": already recovered" << endl;
+            return true;
+        }
+        if ((admin.*import)(path, report)) {
+            cout << "Loaded " << report.rows << " rows from " << path << endl;
+            return true;
+        }
+        cout << "Failed to load " << path;
+        if (report.badRow) cout << " at row " << report.badRow;
+        cout << endl;
+        return false;
+    };
+    return load(halls, storage.getDiningHalls().size() > 0, &Admin::importHalls) &&
+           load(meals, storage.getMeals().size() > 0, &Admin::importMeals) &&
+           load(students, storage.getStudents().size() > 0, &Admin::importStudents) &&
+           load(staff, false, &Admin::importStaff);
+}
+
+// serve <port | unix-socket-path> [reactors] [snapshot wal [events]] [halls=<file>] [meals=<file>] [students=<file>]
+//       [staff=<file>]
+// With persistence a snapshot is taken every Snapshot::kPeriodSeconds and archived history lives in
+// <wal>.history/. Events go next to the WAL unless a path is given; otherwise they are drained and discarded.
+// The setup files (see BulkCatalog) are loaded after recovery and before listening.
+int runServer(int argc, char* argv[]) {
+    vector<char*> positional;
+    string halls, meals, students, staff;
+    bool known = true;
+    for (int i = 0; i < argc; ++i) {
+        const char* eq = i > 1 ? strchr(argv[i], '=') : nullptr;
+        string_view key(argv[i], eq ? static_cast<size_t>(eq - argv[i]) : 0);
+        if (!eq) positional.push_back(argv[i]);
+        else if (key == "halls") halls = eq + 1;
+        else if (key == "meals") meals = eq + 1;
+        else if (key == "students") students = eq + 1;
+        else if (key == "staff") staff = eq + 1;
+        else known = false;
     }
-};
-int main (){}
\ No newline at end of file
+    if (!known || positional.size() < 3) {
+        cout << "usage: serve <port|socket-path> [reactors] [snapshot wal [events]] [halls=file] [meals=file] "
+                "[students=file] [staff=file]" << endl;
+        return 2;
+    }
+    argc = static_cast<int>(positional.size());
+    argv = positional.data();
+    string events = argc > 6 ? argv[6] : argc > 5 ? string(argv[5]) + ".events" : "/dev/null";
+    if (!EventLog::instance().open(events)) cout << "Failed to open event log " << events << endl;
+    if (argc > 5) {
+        string history = string(argv[5]) + ".history";
+        if (mkdir(history.c_str(), 0755) != 0 && errno != EEXIST) cout << "Failed to create " << history << endl;
+        else HistoryArchive::instance().open(history);
+        size_t applied;
+        if (!Snapshot::recover(argv[4], argv[5], applied)) {
+            cout << "Refusing to start: " << argv[4] << " and " << argv[5] << " do not add up to a consistent state"
+                 << endl;
+            EventLog::instance().close();
+            return 1;
+        }
+        if (!WriteAheadLog::instance().open(argv[5])) cout << "Failed to open WAL " << argv[5] << endl;
+        else Snapshot::instance().startPeriodic(argv[4], Snapshot::kPeriodSeconds);
+    }
+    if (!loadSetup(halls, meals, students, staff)) {
+        Snapshot::instance().stopPeriodic();
+        WriteAheadLog::instance().close();
+        EventLog::instance().close();
+        return 1;
+    }
+
+    string endpoint = argv[2];
+    size_t reactors = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : thread::hardware_concurrency();
+    bool numeric = !endpoint.empty() && endpoint.find_first_not_of("0123456789") == string::npos;
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Server server(reactors);
+    bool listening = numeric ? server.listenTcp(static_cast<uint16_t>(atoi(endpoint.c_str()))) : server.listenUnix(endpoint);
+    if (!listening || !server.start()) {
+        cout << "Failed to listen on " << endpoint << endl;
+        return 1;
+    }
+    if (numeric) cout << "Listening on 127.0.0.1:" << server.getPort() << endl;
+    else cout << "Listening on " << endpoint << endl;
+
+    int sig;
+    sigwait(&signals, &sig);
+    server.stop();
+    Snapshot::instance().stopPeriodic();
+    WriteAheadLog::instance().close();
+    EventLog::instance().close();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "bench-lookup") Bench::mealLookup();
+    else if (mode == "bench-seats") Bench::seatContention();
+    else if (mode == "bench-ids") Bench::idScaling();
+    else if (mode == "bench-analytics") Bench::analytics();
+    else if (mode == "bench-menu") Bench::menuReads();
+    else if (mode == "bench-import") Bench::bulkImport();
+    else if (mode == "stress-ledger") return Bench::ledgerStress() ? 0 : 1;
+    else if (mode == "serve") return runServer(argc, argv);
+    else if (mode == "loadgen") return LoadGen::run(argc, argv);
+#ifdef ALLOC_CHECK
+    else if (mode == "check-allocs") return AllocCheck::readPaths();
+#endif
+}
\ No newline at end of file